@@ -0,0 +1,153 @@
+/*
+ * Pool of generated columns
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a pool of the columns that column generation
+   found for one set of demands, together with the final basis, so that
+   the next solve on the same platforms can start from them. Every column
+   is stored as its route (the platforms, in the order in which the 
+   capacity was given to them), the capacity given to each platform, and
+   the length of the route. The basis is stored as the GLPK status of the
+   rows, of the N single-platform columns and of the other columns.
+   Pools are kept in text files. Like a TSP cache file, a file carries a
+   fingerprint of the platform data and range, and a file with a different
+   fingerprint is ignored. */
+
+#ifndef COLUMNPOOL__
+#define COLUMNPOOL__
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+/* Version of the file format */
+#define _COLUMNPOOL_VERSION 1
+
+struct ColumnPool {
+  // a generated column
+  struct Column {
+    std::vector<int> platforms;   // route, in the order of the capacity split
+    std::vector<int> w;           // capacity given to each of the platforms
+    double length;                // length of the route
+    int status;                   // GLPK status in the final basis
+  };
+
+  int N;                          // number of platforms
+  std::vector<int> row_status;    // GLPK status of rows 1, ..., N
+  std::vector<int> single_status; // GLPK status of columns 1, ..., N
+  std::vector<Column> columns;    // columns N + 1, N + 2, ...
+
+  ColumnPool() : N(0) { }
+
+  bool empty() const {
+    return columns.empty() && row_status.empty();
+  }
+
+  void clear() {
+    N = 0;
+    row_status.clear();
+    single_status.clear();
+    columns.clear();
+  }
+
+  // Read a pool from a file. Returns false if the file cannot be read or
+  // does not belong to the given fingerprint; the pool is then empty.
+  bool load(const std::string& path, uint64_t fingerprint) {
+    clear();
+    std::ifstream f(path.c_str());
+    std::string magic;
+    int version = 0;
+    uint64_t file_fingerprint = 0;
+    size_t count = 0;
+    f >> magic >> version >> file_fingerprint >> N >> count;
+    if (!f || (magic != "COLUMNPOOL") || (version != _COLUMNPOOL_VERSION)
+        || (file_fingerprint != fingerprint) || (N < 1)) {
+      clear();
+      return false;
+    }
+    row_status.resize(N);
+    single_status.resize(N);
+    for (int i = 0; i < N; i++)
+      f >> row_status[i];
+    for (int i = 0; i < N; i++)
+      f >> single_status[i];
+    columns.resize(count);
+    size_t j = 0;
+    for ( ; (j < count) && f; j++) {
+      Column &column = columns[j];
+      size_t k = 0;
+      f >> column.length >> column.status >> k;
+      if (!f || (k > static_cast<size_t>(N)))
+        break;
+      column.platforms.resize(k);
+      column.w.resize(k);
+      for (size_t i = 0; i < k; i++) {
+        f >> column.platforms[i] >> column.w[i];
+        if ((column.platforms[i] < 1) || (column.platforms[i] > N))
+          f.setstate(std::ios::failbit);
+      }
+    }
+    if (!f || (j < count)) {
+      clear();
+      return false;
+    }
+    return true;
+  }
+
+  // Write the pool to a file, by way of a temporary file so that other
+  // runs never see a partially written file. Returns false on failure.
+  bool save(const std::string& path, uint64_t fingerprint) const {
+    char pid[32];
+    snprintf(pid, sizeof(pid), ".%ld.tmp", static_cast<long>(getpid()));
+    std::string tmp_path = path + pid;
+    std::ofstream f(tmp_path.c_str());
+    f << "COLUMNPOOL " << _COLUMNPOOL_VERSION << " " << fingerprint << " " 
+      << N << " " << columns.size() << std::endl;
+    for (size_t i = 0; i < row_status.size(); i++)
+      f << row_status[i] << ((i + 1 < row_status.size()) ? " " : "\n");
+    for (size_t i = 0; i < single_status.size(); i++)
+      f << single_status[i] << ((i + 1 < single_status.size()) ? " " : "\n");
+    f << std::setprecision(17);
+    for (size_t j = 0; j < columns.size(); j++) {
+      const Column &column = columns[j];
+      f << column.length << " " << column.status << " " << column.platforms.size();
+      for (size_t i = 0; i < column.platforms.size(); i++)
+        f << " " << column.platforms[i] << " " << column.w[i];
+      f << std::endl;
+    }
+    f.close();
+    if (!f || (rename(tmp_path.c_str(), path.c_str()) != 0)) {
+      unlink(tmp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ * Dynamically sized hashable bit set
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a hashable bitset whose number of bits is
+   chosen at runtime. Sets of up to 64 * _DBITSET_INLINE_WORDS bits are
+   stored inside the object, and only larger sets allocate their words on
+   the heap, so that the sets of a few dozen platforms are as cheap to
+   create and copy as a fixed-size bitset. Bitsets can only be compared 
+   and combined with bitsets of the same number of bits. */
+
+#ifndef DBITSET__
+#define DBITSET__
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include <sstream>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+/* Number of 64-bit words that are stored inside the object */
+#define _DBITSET_INLINE_WORDS 2
+
+class dbitset {
+public:
+  // iterator over the elements of the set, in increasing order
+  class iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef int value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const int* pointer;
+    typedef int reference;
+
+    iterator(const dbitset* bs, size_t k) : bs_(bs), k_(k), w_(0) {
+      if (k_ < bs_->words_)
+        w_ = bs_->data_[k_];
+      skip();
+    }
+
+    int operator*() const {
+      return static_cast<int>(64 * k_ + __builtin_ctzll(w_));
+    }
+
+    iterator& operator++() {
+      w_ &= w_ - 1;
+      skip();
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator it(*this);
+      ++(*this);
+      return it;
+    }
+
+    bool operator==(const iterator& it) const {
+      return (k_ == it.k_) && (w_ == it.w_);
+    }
+
+    bool operator!=(const iterator& it) const {
+      return !(*this == it);
+    }
+
+  private:
+    const dbitset* bs_;
+    size_t k_;                   // current word
+    uint64_t w_;                 // bits of the current word still to visit
+
+    // move on to the next word with bits left
+    void skip() {
+      while ((w_ == 0) && (k_ < bs_->words_)) {
+        k_++;
+        w_ = (k_ < bs_->words_) ? bs_->data_[k_] : 0;
+      }
+    }
+  };
+
+  // constructor initializes an empty bitset with room for nbits bits
+  explicit dbitset(size_t nbits = 0) : nbits_(nbits), words_(num_words(nbits)) {
+    data_ = (words_ <= _DBITSET_INLINE_WORDS) ? inline_ : new uint64_t[words_];
+    memset(data_, 0, words_ * sizeof(uint64_t));
+  }
+
+  // copy constructor
+  dbitset(const dbitset& bs) : nbits_(bs.nbits_), words_(bs.words_) {
+    data_ = (words_ <= _DBITSET_INLINE_WORDS) ? inline_ : new uint64_t[words_];
+    memcpy(data_, bs.data_, words_ * sizeof(uint64_t));
+  }
+
+  // assignment operator; the words are only reallocated if the sizes differ
+  dbitset& operator=(const dbitset& rhs) {
+    if (this == &rhs)      // Same object?
+      return *this;
+    if (words_ != rhs.words_) {
+      if (data_ != inline_)
+        delete[] data_;
+      words_ = rhs.words_;
+      data_ = (words_ <= _DBITSET_INLINE_WORDS) ? inline_ : new uint64_t[words_];
+    }
+    nbits_ = rhs.nbits_;
+    for (size_t i = 0; i < words_; i++)
+      data_[i] = rhs.data_[i];
+    return *this;
+  }
+
+  ~dbitset() {
+    if (data_ != inline_)
+      delete[] data_;
+  }
+
+  // equality operator
+  bool operator ==(const dbitset& bs) const {
+    assert(words_ == bs.words_);
+    uint64_t diff = 0;
+    for (size_t i = 0; i < words_; i++)
+      diff |= data_[i] ^ bs.data_[i];
+    return diff == 0;
+  }
+
+  bool operator !=(const dbitset& bs) const {
+    return !(*this == bs);
+  }
+
+  // function to set a bit
+  void set(const int i) {
+    assert((i >= 0) && (i < nbits_));
+    data_[i / 64] |= static_cast<uint64_t>(1) << (i % 64);
+  }
+
+  // function to reset a bit
+  void reset(const int i) {
+    assert((i >= 0) && (i < nbits_));
+    data_[i / 64] &= ~(static_cast<uint64_t>(1) << (i % 64));
+  }
+
+  // function to get a bit
+  bool get(const int i) const {
+    assert((i >= 0) && (i < nbits_));
+    return (data_[i / 64] >> (i % 64)) & 1;
+  }
+
+  // reset all bits
+  void clear() {
+    memset(data_, 0, words_ * sizeof(uint64_t));
+  }
+
+  // bits 64*k, ..., 64*k+63 of the set as a 64-bit word
+  uint64_t word64(const size_t k) const {
+    return data_[k];
+  }
+
+  // the 64-bit words of the set
+  const uint64_t* words() const {
+    return data_;
+  }
+
+  // number of 64-bit words
+  size_t num_words() const {
+    return words_;
+  }
+
+  // number of 64-bit words of a set of nbits bits
+  static size_t num_words(size_t nbits) {
+    return (nbits + 63) / 64;
+  }
+
+  // union, intersection and symmetric difference
+  dbitset& operator|=(const dbitset& bs) {
+    assert(words_ == bs.words_);
+    for (size_t i = 0; i < words_; i++)
+      data_[i] |= bs.data_[i];
+    return *this;
+  }
+
+  dbitset& operator&=(const dbitset& bs) {
+    assert(words_ == bs.words_);
+    for (size_t i = 0; i < words_; i++)
+      data_[i] &= bs.data_[i];
+    return *this;
+  }
+
+  dbitset& operator^=(const dbitset& bs) {
+    assert(words_ == bs.words_);
+    for (size_t i = 0; i < words_; i++)
+      data_[i] ^= bs.data_[i];
+    return *this;
+  }
+
+  dbitset operator|(const dbitset& bs) const {
+    dbitset result(*this);
+    return result |= bs;
+  }
+
+  dbitset operator&(const dbitset& bs) const {
+    dbitset result(*this);
+    return result &= bs;
+  }
+
+  dbitset operator^(const dbitset& bs) const {
+    dbitset result(*this);
+    return result ^= bs;
+  }
+
+  // check whether every element of this set is in bs
+  bool is_subset_of(const dbitset& bs) const {
+    assert(words_ == bs.words_);
+    uint64_t rest = 0;
+    for (size_t i = 0; i < words_; i++)
+      rest |= data_[i] & ~bs.data_[i];
+    return rest == 0;
+  }
+
+  // check whether the set has no elements
+  bool empty() const {
+    uint64_t any = 0;
+    for (size_t i = 0; i < words_; i++)
+      any |= data_[i];
+    return any == 0;
+  }
+
+  iterator begin() const {
+    return iterator(this, 0);
+  }
+
+  iterator end() const {
+    return iterator(this, words_);
+  }
+
+  // maximum number of bits in the set
+  size_t capacity() const {
+    return nbits_;
+  }
+
+  // number of bits in the set (i.e. number of ones)
+  size_t size() const {
+    size_t count = 0;
+    for (size_t i = 0; i < words_; i++)
+      count += __builtin_popcountll(data_[i]);
+    return count;
+  }
+
+  // calculate a hash value of the words of a set
+  static inline size_t hash(const uint64_t* words, size_t n) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; i++) {
+      value ^= words[i];
+      value ^= value >> 33;
+      value *= 0xff51afd7ed558ccdULL;
+      value ^= value >> 33;
+      value *= 0xc4ceb9fe1a85ec53ULL;
+      value ^= value >> 33;
+    }
+    return value;
+  }
+
+  size_t hash() const {
+    return hash(data_, words_);
+  }
+
+  // print out the contents of the set
+  std::string str() const {
+    std::stringstream ss;
+    ss << "{";
+    bool first = true;
+    for (iterator it = begin(); it != end(); ++it) {
+      if (!first)
+        ss << ",";
+      else
+        first = false;
+      ss << *it;
+    }
+    ss << "}";
+    return ss.str();
+  }
+
+private:
+  size_t nbits_;
+  size_t words_;
+  uint64_t* data_;                           // inline_ or an array on the heap
+  uint64_t inline_[_DBITSET_INLINE_WORDS];
+};
+
+namespace std {
+
+template<>
+struct hash<dbitset> {
+  std::size_t operator() (const dbitset &bs) const {
+    return bs.hash();
+  }
+};
+
+}
+
+#endif
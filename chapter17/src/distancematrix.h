@@ -0,0 +1,121 @@
+/*
+ * Contiguous distance matrix
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a square matrix of distances that is stored in
+   a single block of memory. Every row starts on a cache line: the row
+   stride is rounded up to _DISTANCEMATRIX_ALIGN bytes, which is also the
+   width of the widest vector registers, and the padding is filled with
+   zeros. d[a][b] is therefore a single load from the start of the block,
+   and a vector kernel can read whole rows with aligned loads. */
+
+#ifndef DISTANCEMATRIX__
+#define DISTANCEMATRIX__
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+/* Alignment of the rows in bytes */
+#define _DISTANCEMATRIX_ALIGN 64
+
+class DistanceMatrix {
+public:
+  // constructor initializes an n x n matrix of zeros
+  explicit DistanceMatrix(size_t n = 0)
+    : n_(0), stride_(0), data_(NULL) {
+    resize(n);
+  }
+
+  // copy constructor
+  DistanceMatrix(const DistanceMatrix& m)
+    : n_(0), stride_(0), data_(NULL) {
+    *this = m;
+  }
+
+  // assignment operator
+  DistanceMatrix& operator=(const DistanceMatrix& rhs) {
+    if (this == &rhs)      // Same object?
+      return *this;
+    resize(rhs.n_);
+    memcpy(data_, rhs.data_, n_ * stride_ * sizeof(double));
+    return *this;
+  }
+
+  ~DistanceMatrix() {
+    free(data_);
+  }
+
+  // Resize the matrix to n x n, and set all distances to zero.
+  void resize(size_t n) {
+    free(data_);
+    n_ = n;
+    stride_ = round_up(n, _DISTANCEMATRIX_ALIGN / sizeof(double));
+    data_ = static_cast<double*>(allocate(n_ * stride_ * sizeof(double)));
+  }
+
+  // number of rows (and columns)
+  size_t size() const {
+    return n_;
+  }
+
+  // distance between rows of the matrix, in entries
+  size_t stride() const {
+    return stride_;
+  }
+
+  // row a of the matrix, so that d[a][b] is the distance from a to b
+  double* operator[](size_t a) {
+    assert(a < n_);
+    return data_ + a * stride_;
+  }
+
+  const double* operator[](size_t a) const {
+    assert(a < n_);
+    return data_ + a * stride_;
+  }
+
+private:
+  size_t n_;
+  size_t stride_;               // row stride, a multiple of the alignment
+  double* data_;
+
+  static size_t round_up(size_t n, size_t k) {
+    return (n + k - 1) / k * k;
+  }
+
+  // allocate a block of zeros aligned to _DISTANCEMATRIX_ALIGN bytes
+  static void* allocate(size_t bytes) {
+    void* p = NULL;
+    if (posix_memalign(&p, _DISTANCEMATRIX_ALIGN, (bytes > 0) ? bytes : 1) != 0)
+      throw std::bad_alloc();
+    memset(p, 0, bytes);
+    return p;
+  }
+};
+
+#endif
@@ -26,6 +26,8 @@
 
 #include <assert.h>
 #include <math.h>
+#include <getopt.h>
+#include <glob.h>
 #include <glpk.h>
 #include <sys/time.h>
 #include <time.h>
@@ -33,14 +35,31 @@
 #include <inttypes.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
 #include <vector>
-#include <unordered_map>
 
-#include "hbitset.h"
+#include "columnpool.h"
+#include "dbitset.h"
+#include "distancematrix.h"
+#include "tourtable.h"
+#include "tspcache.h"
+#include "tspcachefile.h"
+#include "infeasiblesets.h"
+#include "routecatalog.h"
+#include "sidepool.h"
+#include "workstealing.h"
 
 using namespace std;
 
@@ -50,11 +69,91 @@ using namespace std;
 /* Maximum number of columns to add per iteration */
 #define MAX_COLUMNS_PER_ITERATION 15
 
+/* The pricing walk is split into one task per prefix of this many 
+   platforms; the tasks are divided over the threads (see --threads). */
+#define PRICING_SPLIT_DEPTH 2
+
+/* Largest number of platforms; the route catalog and the side pool store
+   platform indices (including the airport 0) in 16 bits. */
+#define MAX_PLATFORMS 65535
+
 /* Precision of objective value output */
 #define OBJ_OUTPUT_PRECISION 3
 
-/* Maximum number of platforms supported, INCLUDING the airport. */
-#define MAXPLATFORMS 64
+/* Largest number of platforms in a set for which the TSP tour is calculated
+   by going through a compile-time table of all its tours (see tourtable.h).
+   The table for 7 platforms has 2520 tours. */
+#define TOUR_TABLE_MAX_SIZE 7
+
+/* Smallest number of platforms in a set for which the TSP tour is calculated
+   with the Held-Karp dynamic program rather than by branch-and-bound.
+   Set to 1 to always use Held-Karp. */
+#define HELD_KARP_MIN_SIZE 14
+
+/* Largest number of platforms for which Held-Karp is used; its table has
+   2^n * n entries, so 20 platforms take 160 MB. Larger sets fall back to
+   branch-and-bound. */
+#define HELD_KARP_MAX_SIZE 20
+
+/* Smallest number of platforms in a set whose tour is bounded and 
+   estimated before it is solved (see --tiered-pricing); the tours of 
+   smaller sets are cheap to solve and then found in the cache. */
+#define TIERED_PRICING_MIN_SIZE 3
+
+/* Largest set that is routed incrementally while walking the subset tree
+   during pricing (see TspLattice); its table has 2^n * n entries. */
+#define LATTICE_MAX_SIZE 16
+
+/* Pricing methods: enumerate the platform sets in the order of their dual
+   values, or look for columns among the routes enumerated before first, or
+   find the routes with a labeling algorithm (see price_labeling) */
+enum PricingMethod { PRICING_WALK, PRICING_CATALOG, PRICING_LABELING };
+
+/* Rounding strategies: the flight of the LP solution that the round-off
+   algorithm fixes is chosen at random, or is the one with the largest 
+   value, or with the largest fractional part. The portfolio runs the
+   first two trials with the deterministic strategies and the others at
+   random, and lets the trials share the best solution found so far. */
+enum RoundingStrategy { ROUNDING_RANDOM, ROUNDING_LARGEST, ROUNDING_FRACTIONAL,
+                        ROUNDING_PORTFOLIO };
+
+/* Structure for storing the command line options */
+struct Options {
+  size_t cache_memory;        // memory limit of the TSP cache (bytes), 0 if none
+  size_t cache_entries;       // limit on the number of cached tours, 0 if none
+  string cache_file;          // file in which tours are kept between runs, if any
+  PricingMethod pricing;      // how columns are generated
+  int threads;                // number of threads of the pricing walk
+  int trials;                 // number of rounding trials
+  int trial_threads;          // number of trials that run at the same time
+  bool has_seed;              // whether the random seed was given
+  uint64_t seed;              // random seed from which the trials' seeds follow
+  RoundingStrategy rounding;  // how the round-off algorithm picks flights
+  double gap;                 // stop once a solution is within this fraction
+                              // of the LP relaxation, if nonnegative
+  bool batch;                 // whether a list of demand files is solved
+  int batch_threads;          // number of scenarios solved at the same time
+  string load_columns;        // file with the columns to start from, if any
+  string save_columns;        // file to which the columns are saved, if any
+  bool warm_start;            // whether a scenario starts from the columns of
+                              // the previous one
+  double smoothing;           // weight of the stability center in the duals
+  string cg_trace;            // file to which column generation is traced
+  int column_age;             // iterations after which a nonbasic column with
+                              // positive reduced cost leaves the model, 0 if never
+  double cg_gap;              // gap to the lower bound at which the column
+                              // generation of a rounding step stops, if positive
+  bool tiered_pricing;        // whether the walk bounds and estimates tours
+                              // before solving them
+
+  Options() : cache_memory(0), cache_entries(0), pricing(PRICING_CATALOG),
+              threads(1), trials(16), trial_threads(1), has_seed(false), seed(0),
+              rounding(ROUNDING_RANDOM), gap(-1.0), batch(false), batch_threads(1),
+              warm_start(false), smoothing(0.0), column_age(0),
+              cg_gap(0.0), tiered_pricing(false) { }
+};
+
+static Options options;
 
 /* Structure for storing 2-dimensional points */
 struct Point {
@@ -73,7 +172,7 @@ struct Flight {
 struct ProblemData {
   int N, R, C;                // #platforms, range, capacity
   vector<Point> P;            // list of platform coordinates
-  vector<vector<double> > d;  // 2d array of pairwise distances
+  DistanceMatrix d;           // 2d array of pairwise distances
   vector<int> D;              // list of crew exchange demands
 };
 
@@ -93,47 +192,127 @@ class SortBy {
 
 /* This function just outputs a string preceded and followed by a horizontal 
    line. */
-inline void banner(const string& s)
+inline void banner(const string& s, ostream& out = cout)
 {
-  cout << endl;
-  cout << string(80, '-') << endl;
-  cout << s << endl;
-  cout << string(80, '-') << endl;
+  out << endl;
+  out << string(80, '-') << endl;
+  out << s << endl;
+  out << string(80, '-') << endl;
 }
 
 /* Square of */
 inline double sqr(const double x) { return x * x; }
 
-/* This function constructs the next subset of {0, ..., K-1}, in the
-   lexicographical order. If extend is set to false, then all supersets
-   of the current set are skipped. */
-bool next_lex_subset(vector<int> &z, const int K, const bool extend) {
-  if (z.capacity() < K)
-    z.reserve(K);
+/* This class enumerates subsets S of a list of platforms P in 
+   lexicographical order of their positions in P. If next() is called with 
+   extend set to false, then all supersets of the current set S are 
+   skipped. Along with S, the class keeps the quantities that the pricing 
+   loop needs for S, level by level: S as a bitset, the total demand of S,
+   and the column of the flight through S, with the capacity given to the
+   platforms in the order of P. Going from one set to the next only 
+   changes the last level, so every set takes a few operations.
+   The enumeration can be restricted to the subsets that extend a given
+   prefix, i.e. to a subtree of the enumeration tree. */
+class SubsetEnumerator {
+ public:
+  SubsetEnumerator(const ProblemData &data, const vector<int> &P, const vector<double> &y)
+    : data_(&data), P_(&P), y_(&y), n_(0), root_(0), K_(P.size()) {
+    z_.resize(K_);
+    S_.reserve(K_);
+    bs_.assign(K_ + 1, dbitset(data.N + 1));
+    capacity_.resize(K_ + 1);
+    demand_.resize(K_ + 1);
+    value_.resize(K_ + 1);
+    ind_.resize(K_ + 1);
+    val_.resize(K_ + 1);
+    capacity_[0] = data.C;
+    demand_[0] = 0;
+    value_[0] = 0.0;
+  }
 
-  int n = z.size();
+  // Restrict the enumeration to the sets that consist of the platforms at
+  // the given (increasing) positions in P followed by platforms at later
+  // positions. The current set becomes the set given by the prefix.
+  void start(const vector<int> &prefix) {
+    n_ = root_ = prefix.size();
+    for (int k = 0; k < n_; k++) {
+      z_[k] = prefix[k];
+      set_level(k);
+    }
+  }
 
-  if ((extend) && (n < K) && ((n == 0) || (z[n-1] < K-1))) {
-    // add one more item to the set
-    z.resize(n+1);
-    if (n == 0)
-      z[n] = 0;
-    else
-      z[n] = z[n-1] + 1;
-    n++;
-  } else {
-    // increase the current item
-    z[n-1]++;
-    while (z[n-1] >= K) {
-      n--;
-      if (n == 0) return false;
-      z[n-1]++;
+  // Go to the next subset; returns false if there are no more subsets.
+  bool next(bool extend) {
+    if (extend && (n_ < K_) && ((n_ == 0) || (z_[n_ - 1] < K_ - 1))) {
+      // add one more item to the set
+      z_[n_] = (n_ == 0) ? 0 : z_[n_ - 1] + 1;
+      n_++;
+    } else {
+      // increase the current item
+      if (n_ == root_)
+        return false;
+      z_[n_ - 1]++;
+      while (z_[n_ - 1] >= K_) {
+        n_--;
+        if (n_ == root_) return false;
+        z_[n_ - 1]++;
+      }
     }
-    z.resize(n);
+    set_level(n_ - 1);
+    return true;
   }
 
-  return true;
-}
+  // the current set, in the order of P
+  const vector<int>& set() const { return S_; }
+
+  // the positions in P of the platforms in the current set
+  void positions(vector<int> &z) const { z.assign(z_.begin(), z_.begin() + n_); }
+
+  // the current set as a bitset
+  const dbitset& bitset() const { return bs_[n_]; }
+
+  // sum of the demands of the platforms in the current set
+  int demand() const { return demand_[n_]; }
+
+  // sum of w[i] y[i] over the platforms in the current set, so that the 
+  // reduced cost of the flight is its length minus this value
+  double value() const { return value_[n_]; }
+
+  // the column of the flight in GLPK format: entries 1, ..., |S|
+  int* ind() { return &ind_[0]; }
+  double* val() { return &val_[0]; }
+
+ private:
+  const ProblemData* data_;
+  const vector<int>* P_;
+  const vector<double>* y_;
+  int n_;                               // size of the current set
+  int root_;                            // size of the prefix, see start()
+  int K_;                               // number of platforms in P
+  vector<int> z_;                       // positions in P of the current set
+  vector<int> S_;                       // the current set
+  vector<dbitset> bs_;                  // the first k platforms as a bitset
+  vector<int> capacity_;                // capacity left after k platforms
+  vector<int> demand_;                  // demand of the first k platforms
+  vector<double> value_;                // sum of w[i] y[i] of the first k platforms
+  vector<int> ind_;
+  vector<double> val_;
+
+  // fill in level k + 1 for the platform at position k of the set
+  void set_level(int k) {
+    int i = (*P_)[z_[k]];
+    S_.resize(k + 1);
+    S_[k] = i;
+    int w = min(capacity_[k], data_->D[i]);
+    bs_[k + 1] = bs_[k];
+    bs_[k + 1].set(i);
+    capacity_[k + 1] = capacity_[k] - w;
+    demand_[k + 1] = demand_[k] + data_->D[i];
+    value_[k + 1] = value_[k] + w * (*y_)[i];
+    ind_[k + 1] = i;
+    val_[k + 1] = w;
+  }
+};
 
 /* This function returns the objective function value corresponding to a set
    of flights. */
@@ -163,11 +342,8 @@ void print_solution(const vector<Flight> &solution, ostream& s)
   }
 }
 
-/* This function reads the platform coordinates and demanded crew exchanges */
-bool read_data(const string &platform_file, const string &demand_file, ProblemData& data) {
-  cout << "Reading platform and crew exchange data" << endl;
-
-  /* Read platform coordinates */
+/* This function reads the platform coordinates */
+bool read_platforms(const string &platform_file, ProblemData& data) {
   ifstream Pfile(platform_file.c_str());
   if (!Pfile) {
     cerr << "Could not open file " << platform_file << endl;
@@ -184,8 +360,9 @@ bool read_data(const string &platform_file, const string &demand_file, ProblemDa
          << "C=" << C << "." << endl;
     return false;
   }
-  if (N > MAXPLATFORMS-1) {
-    cerr << "Too many platforms. Raise MAXPLATFORMS and recompile." << endl;
+  if (N > MAX_PLATFORMS) {
+    cerr << "Too many platforms: N=" << N << ", at most " 
+         << MAX_PLATFORMS << " are supported." << endl;
     return false;
   }
   
@@ -200,7 +377,16 @@ bool read_data(const string &platform_file, const string &demand_file, ProblemDa
   }
   Pfile.close();
 
-  /* Read demanded crew exchanges */
+  data.N = N;
+  data.R = 200;
+  data.C = 23;
+  data.P = P;
+  return true;
+}
+
+/* This function reads the demanded crew exchanges of the platforms read
+   by read_platforms */
+bool read_demands(const string &demand_file, ProblemData& data) {
   ifstream Wfile(demand_file.c_str());
   if (!Wfile) {
     cerr << "Could not open file " << demand_file << endl;
@@ -209,21 +395,31 @@ bool read_data(const string &platform_file, const string &demand_file, ProblemDa
 
   vector<int> D;
   D.push_back(0);                         // demand at the airport is zero
-  for (int i = 1; i <= N; i++) {
+  for (int i = 1; i <= data.N; i++) {
     int index, demand;
     Wfile >> index >> demand;
     assert(index == i);
     D.push_back(demand);
   }
+  if (!Wfile) {
+    cerr << "Could not read the demands of " << data.N << " platforms from " 
+         << demand_file << endl;
+    return false;
+  }
   Wfile.close();
 
-  data.N = N;
-  data.R = 200;
-  data.C = 23;
-  data.P = P;
   data.D = D;
+  return true;
+}
+
+/* This function reads the platform coordinates and demanded crew exchanges */
+bool read_data(const string &platform_file, const string &demand_file, ProblemData& data) {
+  cout << "Reading platform and crew exchange data" << endl;
+
+  if (!read_platforms(platform_file, data) || !read_demands(demand_file, data))
+    return false;
   
-  cout << "Succesfully read data for " << N << " platforms" << endl;
+  cout << "Succesfully read data for " << data.N << " platforms" << endl;
   
   return true;
 }
@@ -235,8 +431,6 @@ void calculate_distances(ProblemData &data) {
 
   /* Construct empty (N+1)x(N+1) matrix */
   data.d.resize(N+1);
-  for (int i = 0; i <= N; i++)
-    data.d[i].resize(N+1);
 
   /* Calculate pairwise distances */
   for (int i = 0; i <= N; i++)
@@ -273,12 +467,108 @@ void free_lp(glp_prob *lp) {
 }
 
 
-static long tsp_count = 0;
-static long tsp_cache_hit = 0;
-static uint64_t tsp_solve_time = 0;
-static uint64_t tsp_cache_time = 0;
-static uint64_t last_tsp_report = 0;
-static unordered_map<hbitset<MAXPLATFORMS>, double> tsp_cache;
+/* Statistics of solve_tsp calls. Every thread counts its own calls in a
+   thread-local copy, so that the counters are never written by two threads;
+   tsp_report adds up the copies of all threads, or of the threads working
+   for one scope (see TspStatsScope). */
+struct TspStats {
+  atomic<uint64_t> count;         // number of solve_tsp calls
+  atomic<uint64_t> cache_hit;     // number of calls answered by the cache
+  atomic<uint64_t> solve_time;    // time spent calculating tours, in mcs
+  atomic<uint64_t> cache_time;    // time spent in the cache, in mcs
+  atomic<uint64_t> bound_settled; // sets settled by a tour bound (see --tiered-pricing)
+  atomic<uint64_t> heuristic_settled; // sets settled by a heuristic tour
+
+  TspStats() : count(0), cache_hit(0), solve_time(0), cache_time(0),
+               bound_settled(0), heuristic_settled(0) { }
+
+  // Only the owning thread updates the counters, so a plain load and
+  // store suffices; other threads may read them at any time.
+  static inline void add(atomic<uint64_t> &counter, uint64_t value) {
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+  }
+
+  // Add (or, with sign -1, subtract) the counters of stats. The counters
+  // wrap around, so a difference is right even if a part is subtracted
+  // before it is added.
+  void add(const TspStats &stats, int sign = 1) {
+    add(count, sign * stats.count.load(memory_order_relaxed));
+    add(cache_hit, sign * stats.cache_hit.load(memory_order_relaxed));
+    add(solve_time, sign * stats.solve_time.load(memory_order_relaxed));
+    add(cache_time, sign * stats.cache_time.load(memory_order_relaxed));
+    add(bound_settled, sign * stats.bound_settled.load(memory_order_relaxed));
+    add(heuristic_settled, sign * stats.heuristic_settled.load(memory_order_relaxed));
+  }
+};
+
+/* Statistics of a part of the run that several threads may work for at
+   the same time, such as a scenario of a batch run. A thread counts for 
+   one scope at a time. Reports are also split in generations; a new 
+   generation is started by every trial that runs on its own. */
+struct TspStatsScope {
+  TspStats left;              // counts of threads while they were in the scope
+  TspStats generation;        // totals when the current generation started
+  int generation_number;
+
+  TspStatsScope() : generation_number(0) { }
+};
+
+static mutex tsp_stats_lock;              // protects the variables below
+static vector<TspStats*> tsp_stats_threads;
+static TspStats tsp_stats_exited;         // totals of threads that have exited
+static TspStatsScope tsp_stats_all;       // scope of the whole run
+
+/* The statistics of the current thread. They are registered with 
+   tsp_stats_threads when the thread first calls solve_tsp, and moved to
+   tsp_stats_exited when the thread exits. The counts made since the thread
+   entered its scope are the counters minus scope_start. */
+class TspThreadStats : public TspStats {
+ public:
+  TspStatsScope* scope;
+  TspStats scope_start;
+
+  TspThreadStats() : scope(&tsp_stats_all) {
+    lock_guard<mutex> guard(tsp_stats_lock);
+    tsp_stats_threads.push_back(this);
+  }
+  ~TspThreadStats() {
+    lock_guard<mutex> guard(tsp_stats_lock);
+    leave_scope();
+    tsp_stats_exited.add(*this);
+    tsp_stats_threads.erase(find(tsp_stats_threads.begin(), tsp_stats_threads.end(), this));
+  }
+
+  // Move the counts made in the current scope to the scope. The caller
+  // should hold tsp_stats_lock.
+  void leave_scope() {
+    scope->left.add(*this);
+    scope->left.add(scope_start, -1);
+    scope_start.add(scope_start, -1);     // scope_start = *this
+    scope_start.add(*this);
+  }
+};
+
+static thread_local TspThreadStats tsp_stats;
+static atomic<uint64_t> last_tsp_report(0);
+// The sets in the containers below are bitsets of N + 1 bits (platform 0
+// is the airport); they are sized in main once N is known.
+static ShardedTspCache<> tsp_cache;
+
+// tours calculated by earlier runs (see --cache-file)
+static TspCacheFile tsp_cache_file;
+
+// minimal sets of platforms with a tour longer than the range
+static InfeasibleSetIndex infeasible_sets;
+
+// sets of platforms within range that were found while pricing
+static RouteCatalog route_catalog;
+
+// trace of the iterations of column generation (see --cg-trace); every
+// call of run_column_generation is numbered as a solve
+static mutex cg_trace_lock;
+static ofstream cg_trace;
+static atomic<int> cg_trace_solves(0);
+
 
 // needs -lrt (real-time lib)
 // 1970-01-01 epoch UTC time, 1 mcs resolution (divide by 1M to get time_t)
@@ -289,104 +579,1067 @@ uint64_t ClockGetTime()
     return (uint64_t)ts.tv_sec * 1000000LL + (uint64_t)ts.tv_nsec / 1000LL;
 }
 
-void tsp_report() {
-    cout << fixed << tsp_count << " solve_tsp calls, " 
+// monotonic time with 1 mcs resolution; unlike the CPU time clock, this 
+// does not need a system call, so it is used to time individual TSP calls
+uint64_t TimerGetTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000LL + (uint64_t)ts.tv_nsec / 1000LL;
+}
+
+/* This function adds up the statistics of all threads. The caller should
+   hold tsp_stats_lock. */
+void tsp_total_stats(TspStats &total) {
+    total.add(tsp_stats_exited);
+    for (int i = 0; i < tsp_stats_threads.size(); i++)
+      total.add(*tsp_stats_threads[i]);
+}
+
+/* This function adds up the statistics of the threads while they worked
+   for scope. The caller should hold tsp_stats_lock. */
+void tsp_scope_stats(const TspStatsScope* scope, TspStats &total) {
+    if (scope == &tsp_stats_all) {
+      tsp_total_stats(total);
+      return;
+    }
+    total.add(scope->left);
+    for (int i = 0; i < tsp_stats_threads.size(); i++) {
+      const TspThreadStats* stats = static_cast<const TspThreadStats*>(tsp_stats_threads[i]);
+      if (stats->scope == scope) {
+        total.add(*stats);
+        total.add(stats->scope_start, -1);
+      }
+    }
+}
+
+/* This function lets the current thread count its solve_tsp calls for 
+   scope from now on. */
+void tsp_enter_scope(TspStatsScope* scope) {
+    if (tsp_stats.scope == scope)
+      return;
+    lock_guard<mutex> guard(tsp_stats_lock);
+    tsp_stats.leave_scope();
+    tsp_stats.scope = scope;
+}
+
+/* This function starts a new generation of the scope of the current 
+   thread. */
+void tsp_start_generation() {
+    TspStatsScope* scope = tsp_stats.scope;
+    lock_guard<mutex> guard(tsp_stats_lock);
+    TspStats total;
+    tsp_scope_stats(scope, total);
+    scope->generation.count = total.count.load();
+    scope->generation.cache_hit = total.cache_hit.load();
+    scope->generation_number++;
+}
+
+/* This function reports the statistics of scope, or if it is not given,
+   of the scope of the current thread. The cache itself is shared by all 
+   scopes, so its size and memory usage are those of the whole run. */
+void tsp_report(ostream &out = cout, TspStatsScope* scope = NULL) {
+    if (scope == NULL)
+      scope = tsp_stats.scope;
+    TspStats total;
+    uint64_t generation_count, generation_hit;
+    int generation;
+    {
+      lock_guard<mutex> guard(tsp_stats_lock);
+      tsp_scope_stats(scope, total);
+      generation_count = total.count - scope->generation.count;
+      generation_hit = total.cache_hit - scope->generation.cache_hit;
+      generation = scope->generation_number;
+    }
+    uint64_t count = total.count;
+    out << fixed << count << " solve_tsp calls, " 
       << "cache hit=" << setprecision(2) 
-      << 100.0 * (tsp_cache_hit / static_cast<double>(tsp_count))
-      << "%, solve time=" << (tsp_solve_time / 1000000.0) << " s, " 
-      << "cache lookup time=" << (tsp_cache_time / 1000000.0) << " s" 
+      << 100.0 * (total.cache_hit / static_cast<double>(count))
+      << "%, solve time=" << (total.solve_time / 1000000.0) << " s, " 
+      << "cache lookup time=" << (total.cache_time / 1000000.0) << " s, "
+      << "cache size=" << tsp_cache.size() 
+      << " (load factor=" << tsp_cache.load_factor() << ")"
       << endl;
+    if (total.bound_settled + total.heuristic_settled > 0)
+      out << "Tiered pricing: " << total.bound_settled << " sets settled by the tour bound, "
+        << total.heuristic_settled << " by a heuristic tour" << endl;
+    out << "TSP cache memory=" << (tsp_cache.memory_usage() / 1048576.0) << " MB, "
+      << "evictions=" << tsp_cache.evictions();
+    if (generation > 0)
+      out << ", generation " << generation << ": " << generation_count 
+        << " calls, cache hit=" 
+        << 100.0 * (generation_hit / static_cast<double>(max(generation_count, (uint64_t) 1)))
+        << "%";
+    out << endl;
     last_tsp_report = ClockGetTime();
 }
 
+/* This function calculates a fingerprint of the data that determines the
+   tour lengths: the distances between the platforms and the range. A TSP
+   cache file is only used by runs with the same fingerprint. */
+uint64_t tsp_fingerprint(const ProblemData &data) {
+  uint64_t h = fnv1a_hash(&data.N, sizeof(data.N));
+  h = fnv1a_hash(&data.R, sizeof(data.R), h);
+  for (int i = 0; i <= data.N; i++)
+    h = fnv1a_hash(&data.d[i][0], (data.N + 1) * sizeof(double), h);
+  return h;
+}
+
+/* This function calculates the weight of a minimum spanning tree on the 
+   points p[0], ..., p[m-1] with Prim's algorithm. The points are reordered
+   in the order in which they join the tree. */
+double spanning_tree_weight(int* p, int m, const DistanceMatrix &d) {
+  double key[m];
+  for (int i = 1; i < m; i++)
+    key[i] = d[p[0]][p[i]];
+  double weight = 0.0;
+  for (int t = 1; t < m; t++) {
+    int best = t;
+    for (int i = t + 1; i < m; i++)
+      if (key[i] < key[best])
+        best = i;
+    weight += key[best];
+    swap(p[t], p[best]);
+    swap(key[t], key[best]);
+    for (int i = t + 1; i < m; i++)
+      if (d[p[t]][p[i]] < key[i])
+        key[i] = d[p[t]][p[i]];
+  }
+  return weight;
+}
+
+/* This function calculates a lower bound on the length of any tour from the
+   airport through the platforms in S. A tour consists of a path through all
+   platforms, which is a spanning tree on S, and two edges at the airport, 
+   i.e. it is a 1-tree. */
+double one_tree_bound(const vector<int> &S, const DistanceMatrix &d) {
+  int n = S.size();
+  if (n == 1)
+    return d[0][S[0]] + d[S[0]][0];
+
+  int p[n];
+  double first = 1e100, second = 1e100;
+  for (int k = 0; k < n; k++) {
+    p[k] = S[k];
+    double e = d[0][S[k]];
+    if (e < first) {
+      second = first;
+      first = e;
+    } else if (e < second) {
+      second = e;
+    }
+  }
+  return first + second + spanning_tree_weight(p, n, d);
+}
+
+/* This class calculates the shortest traveling salesman tour through a set
+   of platforms by depth-first branch-and-bound. A node of the search tree
+   is a path that leaves the airport and visits some of the platforms. Its
+   remaining part goes from the last platform of the path through all
+   unvisited platforms back to the airport, and is therefore a spanning 
+   tree on those points. The length of the path plus the weight of a minimum
+   spanning tree on them is thus a lower bound for every tour below the
+   node, and the node is pruned as soon as this bound reaches the best tour
+   found so far. The search starts with max_value as its bound, and the root
+   is bounded by one_tree_bound, so that a set whose tours are all too long
+   is usually rejected right away. */
+class TspBranchAndBound {
+ public:
+  TspBranchAndBound(const vector<int> &S, const DistanceMatrix &d)
+    : d_(d), S_(S), n_(S.size()), visited_(S.size(), false) { }
+
+  // length of the shortest tour, or max_value if no tour is shorter
+  double solve(double max_value) {
+    z_ = max_value;
+    if (one_tree_bound(S_, d_) < z_)
+      search(0, n_, 0.0);
+    return z_;
+  }
+
+ private:
+  const DistanceMatrix &d_;
+  const vector<int> &S_;
+  int n_;
+  double z_;                     // length of the best tour found so far
+  vector<char> visited_;         // visited_[k] is set if S[k] is on the path
+
+  // Extend the path of the given length, which ends in platform `last`
+  // (or at the airport if last is 0), and leaves `remaining` platforms 
+  // unvisited.
+  void search(int last, int remaining, double length) {
+    // Collect the unvisited platforms, nearest to `last` first, so that
+    // good tours are found early
+    int order[remaining];
+    int m = 0;
+    for (int k = 0; k < n_; k++) {
+      if (visited_[k]) 
+        continue;
+      int j = m++;
+      for (; (j > 0) && (d_[last][S_[k]] < d_[last][S_[order[j-1]]]); j--)
+        order[j] = order[j-1];
+      order[j] = k;
+    }
+
+    // Bound the remaining part of the tour by a spanning tree on `last`,
+    // the unvisited platforms and the airport
+    if ((last != 0) && (remaining >= 2)) {
+      int p[remaining + 2];
+      p[0] = last;
+      p[1] = 0;
+      for (int i = 0; i < m; i++)
+        p[i + 2] = S_[order[i]];
+      if (length + spanning_tree_weight(p, m + 2, d_) >= z_)
+        return;
+    }
+
+    for (int i = 0; i < m; i++) {
+      int k = order[i];
+      double next_length = length + d_[last][S_[k]];
+      if (next_length + d_[S_[k]][0] >= z_)
+        continue;
+      if (remaining == 1) {
+        z_ = next_length + d_[S_[k]][0];
+        return;
+      }
+      visited_[k] = true;
+      search(S_[k], remaining - 1, next_length);
+      visited_[k] = false;
+    }
+  }
+};
+
+/* This function calculates the shortest traveling salesman tour through
+   the platforms in S with the Held-Karp dynamic program. The airport is
+   node 0; entry (mask, j) of the table holds the length of the shortest
+   path that leaves the airport, visits exactly the platforms S[k] with
+   bit k set in mask, and ends at S[j]. The function returns max_value if 
+   there is no tour shorter than max_value. */
+double tsp_held_karp(const vector<int> &S, const DistanceMatrix &d, double max_value) {
+  int n = S.size();
+  assert(n <= HELD_KARP_MAX_SIZE);
+  
+  uint32_t full = (static_cast<uint32_t>(1) << n) - 1;
+
+  // The table is kept between calls to avoid reallocating it every time
+  static thread_local vector<double> table;
+  table.assign(static_cast<size_t>(full + 1) * n, max_value);
+  
+  for (int j = 0; j < n; j++)
+    table[(static_cast<size_t>(1) << j) * n + j] = d[0][S[j]];
+
+  // Extend every path by one platform. Since the distances satisfy the
+  // triangle inequality, any path that ends in S[k] still needs at least
+  // d[S[k]][0] to get back to the airport, so paths for which this is not
+  // below max_value are dropped right away.
+  for (uint32_t mask = 1; mask < full; mask++) {
+    const double* row = &table[static_cast<size_t>(mask) * n];
+    for (int j = 0; j < n; j++) {
+      if ((row[j] >= max_value) || !(mask & (1 << j)))
+        continue;
+      for (int k = 0; k < n; k++) {
+        if (mask & (1 << k))
+          continue;
+        double z = row[j] + d[S[j]][S[k]];
+        if (z + d[S[k]][0] >= max_value)
+          continue;
+        double &entry = table[static_cast<size_t>(mask | (1 << k)) * n + k];
+        if (z < entry)
+          entry = z;
+      }
+    }
+  }
+  
+  // Close the tour by flying back to the airport
+  double z = max_value;
+  const double* row = &table[static_cast<size_t>(full) * n];
+  for (int j = 0; j < n; j++)
+    if (row[j] + d[S[j]][0] < z)
+      z = row[j] + d[S[j]][0];
+  return z;
+}
+
+/* This class calculates the shortest traveling salesman tour through the
+   platforms in S if S has at most K platforms, by copying their distances
+   into a fixed-size matrix on the stack and going through the tour table
+   for |S| platforms. The platforms are sorted first, so that the length
+   does not depend on the order in which S lists them. */
+template <int K>
+struct TourTableDispatch {
+  static double solve(const vector<int> &S, const DistanceMatrix &d) {
+    if (S.size() < K)
+      return TourTableDispatch<K - 1>::solve(S, d);
+
+    int node[K + 1];
+    node[0] = 0;
+    for (int i = 1; i <= K; i++) {
+      int j = i;
+      for (; (j > 1) && (node[j - 1] > S[i - 1]); j--)
+        node[j] = node[j - 1];
+      node[j] = S[i - 1];
+    }
+
+    double dist[(K + 1) * (K + 1)];
+    for (int a = 0; a <= K; a++)
+      for (int b = 0; b <= K; b++)
+        dist[a * (K + 1) + b] = d[node[a]][node[b]];
+    return TourKernel<K>::shortest(dist);
+  }
+};
+
+template <>
+struct TourTableDispatch<0> {
+  static double solve(const vector<int> &, const DistanceMatrix &) {
+    assert(false);
+    return 0.0;
+  }
+};
+
+/* This class evaluates the TSP tours of the sets S visited by the 
+   depth-first subset walk in run_column_generation. The walk reaches every
+   set by appending one platform to a set whose tour it has just evaluated,
+   so the class keeps the Held-Karp table of the current prefix. Entry 
+   (mask, j) holds the length of the shortest path from the airport through
+   the platforms at the positions in mask, ending at position j. Appending a
+   platform at position k only requires the entries of masks containing bit
+   k; all other entries are those of the prefix and are reused as they are.
+   The entries are filled in lazily, so that sets whose length is found in
+   the TSP cache cost nothing. */
+class TspLattice {
+ public:
+  TspLattice(const DistanceMatrix &d, double max_value)
+    : d_(&d), max_value_(max_value), computed_(0) {
+    S_.reserve(LATTICE_MAX_SIZE);
+  }
+
+  // number of platforms in the current set
+  int size() const { return S_.size(); }
+
+  // keep only the first k platforms of the current set
+  void truncate(int k) {
+    if (k < S_.size())
+      S_.resize(k);
+    computed_ = min(computed_, k);
+  }
+
+  // append a platform to the current set
+  void push(int platform) {
+    S_.push_back(platform);
+  }
+
+  // length of the shortest tour through the current set, or max_value if
+  // there is no tour shorter than max_value
+  double tour_length() {
+    int n = S_.size();
+    assert((n > 0) && (n <= LATTICE_MAX_SIZE));
+    while (computed_ < n)
+      compute_level(computed_++);
+
+    const DistanceMatrix &d = *d_;
+    const double* row = entry((1 << n) - 1);
+    double z = max_value_;
+    for (int j = 0; j < n; j++)
+      if (row[j] + d[S_[j]][0] < z)
+        z = row[j] + d[S_[j]][0];
+    return z;
+  }
+
+ private:
+  const DistanceMatrix* d_;
+  double max_value_;
+  vector<int> S_;              // platforms in the order they were appended
+  int computed_;               // number of positions whose entries are valid
+  vector<double> table_;       // entry (mask, j) is at mask * LATTICE_MAX_SIZE + j
+
+  double* entry(uint32_t mask) {
+    return &table_[static_cast<size_t>(mask) * LATTICE_MAX_SIZE];
+  }
+
+  // fill in the entries of all masks whose highest bit is k
+  void compute_level(int k) {
+    const DistanceMatrix &d = *d_;
+    uint32_t bit = static_cast<uint32_t>(1) << k;
+    if (table_.size() < static_cast<size_t>(2 * bit) * LATTICE_MAX_SIZE)
+      table_.resize(static_cast<size_t>(2 * bit) * LATTICE_MAX_SIZE);
+
+    entry(bit)[k] = d[0][S_[k]];
+    for (uint32_t mask = bit + 1; mask < 2 * bit; mask++) {
+      double* row = entry(mask);
+      for (int j = 0; j <= k; j++) {
+        if (!(mask & (1 << j)))
+          continue;
+        // The shortest path ending in S[j] comes from the shortest path
+        // through the other platforms in mask. As in tsp_held_karp, paths
+        // that cannot get back to the airport below max_value are dropped.
+        const double* prev = entry(mask ^ (1 << j));
+        double z = max_value_;
+        for (int i = 0; i <= k; i++) {
+          if ((i == j) || !(mask & (1 << i)) || (prev[i] >= max_value_))
+            continue;
+          if (prev[i] + d[S_[i]][S_[j]] < z)
+            z = prev[i] + d[S_[i]][S_[j]];
+        }
+        row[j] = (z + d[S_[j]][0] < max_value_) ? z : max_value_;
+      }
+    }
+  }
+};
+
+/* This function looks up the length of the shortest tour through the set
+   hb in the cache file and the TSP cache. The tours of the file are read
+   where they are mapped, and not copied into the TSP cache. If from_file
+   is given, it is set to whether the length was found in the cache file. */
+bool cached_tsp(const dbitset &hb, double* z, bool* from_file = NULL) {
+  uint64_t start = TimerGetTime();
+  bool in_file = (tsp_cache_file.size() > 0)
+    && tsp_cache_file.find(hb, TspCache::hash(hb), z);
+  bool found = in_file || tsp_cache.find(hb, z);
+  if (from_file != NULL)
+    *from_file = in_file;
+  TspStats::add(tsp_stats.cache_time, TimerGetTime() - start);
+  return found;
+}
+
+/* This function calculates the length of a tour from the airport through
+   the platforms in S with the cheapest insertion heuristic: starting from
+   the platform farthest from the airport, the platform that makes the tour
+   the least longer is inserted where it does so, until all are in. The 
+   tour is then improved by 2-opt moves, which reverse a part of it, for as
+   long as that makes it shorter. The result is an upper bound on the 
+   shortest tour. */
+double heuristic_tour(const vector<int> &S, const DistanceMatrix &d) {
+  int n = S.size();
+  int tour[n + 2];               // tour[0] = tour[m] = 0, the airport
+  bool inserted[n];
+  int far = 0;
+  for (int k = 0; k < n; k++) {
+    inserted[k] = false;
+    if (d[0][S[k]] > d[0][S[far]])
+      far = k;
+  }
+  tour[0] = 0;
+  tour[1] = S[far];
+  tour[2] = 0;
+  inserted[far] = true;
+  for (int m = 2; m <= n; m++) {
+    // the tour is tour[0], ..., tour[m]; insert before tour[best_pos]
+    int best_k = -1, best_pos = 0;
+    double best = 0.0;
+    for (int k = 0; k < n; k++) {
+      if (inserted[k])
+        continue;
+      for (int pos = 1; pos <= m; pos++) {
+        double extra = d[tour[pos - 1]][S[k]] + d[S[k]][tour[pos]] - d[tour[pos - 1]][tour[pos]];
+        if ((best_k < 0) || (extra < best)) {
+          best_k = k;
+          best_pos = pos;
+          best = extra;
+        }
+      }
+    }
+    for (int pos = m; pos >= best_pos; pos--)
+      tour[pos + 1] = tour[pos];
+    tour[best_pos] = S[best_k];
+    inserted[best_k] = true;
+  }
+
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    for (int i = 1; i < n; i++)
+      for (int j = i + 1; j <= n; j++) {
+        double gain = d[tour[i - 1]][tour[i]] + d[tour[j]][tour[j + 1]]
+          - d[tour[i - 1]][tour[j]] - d[tour[i]][tour[j + 1]];
+        if (gain > 1e-9) {
+          reverse(tour + i, tour + j + 1);
+          improved = true;
+        }
+      }
+  }
+
+  double length = 0.0;
+  for (int k = 0; k <= n; k++)
+    length += d[tour[k]][tour[k + 1]];
+  return length;
+}
+
 /* This function calculates the shortest traveling salesman tour
    starting and ending at the airport, and going through all platforms
    in S, subject to the distance being at most max_value (which will be taken
    to be slightly larger than the range). 
+   Sets of up to TOUR_TABLE_MAX_SIZE platforms are handled by the tour 
+   tables. Larger sets are calculated incrementally if lattice is given and 
+   holds the set S, and otherwise by branch-and-bound or, for medium sizes,
+   by the Held-Karp dynamic program.
    Notice that the function uses a caching mechanism to store
-   previously calculated values. */
+   previously calculated values. If computed is given, it is set to whether
+   the tour of S was new to the cache of this run, i.e. it was calculated or
+   read from the cache file. The set S is also passed as the bitset hb. */
 
-double solve_tsp(vector<int> S, const vector<vector<double> > &d, double max_value) {
+double solve_tsp(const vector<int> &S, const dbitset &hb,
+                 const DistanceMatrix &d, double max_value,
+                 TspLattice* lattice = NULL, bool* computed = NULL) {
   int n = S.size();
   double z;
-  tsp_count++;
+  TspStats::add(tsp_stats.count, 1);
   
-  if (ClockGetTime() - last_tsp_report >= 30000000) // report statistics every 30 s
-    tsp_report();
+  // report statistics every 30 s; of the threads that notice, only the
+  // one that manages to move last_tsp_report forward reports
+  uint64_t last = last_tsp_report;
+  if (((tsp_stats.count % 4096) == 0) && (ClockGetTime() - last >= 30000000)
+      && last_tsp_report.compare_exchange_strong(last, ClockGetTime()))
+    tsp_report(cout, &tsp_stats_all);
 
-  // Sort elements of S
-  sort(S.begin(), S.end());
-  
   // Retrieve value from cache, if it is in there
-  uint64_t start = ClockGetTime();
-  hbitset<MAXPLATFORMS> hb;
+  bool from_file;
+  bool found = cached_tsp(hb, &z, &from_file);
+  if (computed != NULL)
+    *computed = !found || from_file;
+  if (found) {
+    TspStats::add(tsp_stats.cache_hit, 1);
+    return z;
+  }
+
+  uint64_t start = TimerGetTime();
+  if (one_tree_bound(S, d) >= max_value)
+    z = max_value;               // proven to be out of range
+  else if (n <= TOUR_TABLE_MAX_SIZE)
+    z = min(TourTableDispatch<TOUR_TABLE_MAX_SIZE>::solve(S, d), max_value);
+  else if ((lattice != NULL) && (lattice->size() == n) && (n <= LATTICE_MAX_SIZE))
+    z = lattice->tour_length();
+  else if ((n >= HELD_KARP_MIN_SIZE) && (n <= HELD_KARP_MAX_SIZE))
+    z = tsp_held_karp(S, d, max_value);
+  else
+    z = TspBranchAndBound(S, d).solve(max_value);
+  TspStats::add(tsp_stats.solve_time, TimerGetTime() - start);
+
+  // Store result in cache; sets that are out of range are kept longer,
+  // as they save the work on all their supersets
+  start = TimerGetTime();
+  tsp_cache.insert(hb, z, (z >= max_value) ? 2 : 1);
+  TspStats::add(tsp_stats.cache_time, TimerGetTime() - start);
+  return z;
+}
+
+/* This function calculates the shortest tour through S as above, for a set
+   S that is not available as a bitset. */
+double solve_tsp(const vector<int> &S, const DistanceMatrix &d, double max_value,
+                 TspLattice* lattice = NULL, bool* computed = NULL) {
+  dbitset hb(d.size());
   for (int i = 0; i < S.size(); i++)
     hb.set(S[i]);
+  return solve_tsp(S, hb, d, max_value, lattice, computed);
+}
+
 
-  unordered_map<hbitset<MAXPLATFORMS>, double>::iterator it = tsp_cache.find(hb);
-  tsp_cache_time += ClockGetTime() - start;
-  if (it != tsp_cache.end()) {
-    tsp_cache_hit++;
-    return it->second;
+/* This function adds a set S with a tour longer than R to the index of
+   infeasible sets. S is the feasible set S \ {S.back()} extended by its
+   last platform, so the last platform belongs to every infeasible subset
+   of S. The other platforms are dropped from S for as long as the tour 
+   stays longer than R, so that the index only holds minimal sets. */
+void add_infeasible_set(const vector<int> &S, const DistanceMatrix &d, int R) {
+  vector<int> T(S);
+  vector<int> U;
+  for (int k = 0; k + 1 < T.size(); ) {
+    U.assign(T.begin(), T.begin() + k);
+    U.insert(U.end(), T.begin() + k + 1, T.end());
+    if (solve_tsp(U, d, R + 0.1) > R)
+      T.swap(U);
+    else
+      k++;
   }
 
+  dbitset hb(d.size());
+  for (int i = 0; i < T.size(); i++)
+    hb.set(T[i]);
+  infeasible_sets.insert(hb);
+}
+
 
-  // Calculate the minimum distance required to go from any platform
-  // back to the airport. We use this quantity later to prune solutions.
-  double min_way_back = 1e100;
-  for (int i = 0; i < S.size(); i++) 
-    min_way_back = min(min_way_back, d[0][S[i]]);
-    
-  // Here, we go through all permutations of S.
-  z = max_value;
-  start = ClockGetTime();
-  do {
-    // Since any tour and its reverse have the same total distance,
-    // we only need to consider permutations with S[0] < S[n-1]
-    if (S[0] > S[n-1]) 
+/* This function calculates the column of a flight through the platforms
+   in S, which are in order of decreasing dual value y. The capacity is
+   given to the platforms in this order. The nonzero entries are stored in
+   ind[1..|S|] and val[1..|S|] (as expected by GLPK). */
+void flight_column(const vector<int> &S, const ProblemData &data, int* ind, double* val) {
+  int Cremaining = data.C;              // remaining capacity
+  for (int j = 0; j < S.size(); j++) {
+    int i = S[j];                       // we are considering platform P(i)
+    int w = min(Cremaining, data.D[i]); 
+    ind[j+1] = i;
+    val[j+1] = w;
+    Cremaining -= w;                    // update remaining capacity
+  }
+}
+
+/* This function adds a column with n nonzero entries ind[1..n], val[1..n]
+   and objective coefficient dS to the model. */
+void add_column(glp_prob* lp, int n, int* ind, double* val, double dS) {
+  int j = glp_add_cols(lp, 1);
+  glp_set_mat_col(lp, j, n, ind, val);
+  glp_set_obj_coef(lp, j, dS);
+  glp_set_col_bnds(lp, j, GLP_LO, 0.0, 0.0);
+}
+
+/* Structure for storing a column found by the pricing walk */
+struct PricedColumn {
+  vector<int> z;          // positions of its platforms in the list P of the walk
+  vector<int> ind;        // entries 1, ..., |S| as filled in by flight_column
+  vector<double> val;
+  double dS;              // length of the flight
+  double c;               // reduced cost
+};
+
+/* This function orders columns by reduced cost; columns with the same
+   reduced cost are ordered as in the walk. */
+bool by_reduced_cost(const PricedColumn &a, const PricedColumn &b) {
+  return (a.c < b.c) || ((a.c == b.c) && (a.z < b.z));
+}
+
+/* This function orders columns as in the walk, which goes through the
+   sets in lexicographical order of their positions. */
+bool by_walk_order(const PricedColumn &a, const PricedColumn &b) {
+  return a.z < b.z;
+}
+
+/* State of a thread of the pricing walk. The thread walks its own
+   subtrees of the enumeration tree, and keeps the best columns it finds. */
+struct PricingWorker {
+  SubsetEnumerator subsets;
+  TspLattice lattice;
+  InfeasibleSetWalk walk;
+  vector<int> z;
+  vector<PricedColumn> best;   // in order of increasing reduced cost
+  double lowest;               // lowest reduced cost of the sets walked
+  double lowest_per_crew;      // lowest reduced cost per crew member
+
+  PricingWorker(const ProblemData &data, const vector<int> &P, const vector<double> &y)
+    : subsets(data, P, y), lattice(data.d, data.R + 0.1), walk(infeasible_sets),
+      lowest(0.0), lowest_per_crew(0.0) { }
+};
+
+/* This function walks the subsets of P that extend the given prefix 
+   (positions in P) and have a tour within range, and keeps the columns with
+   negative reduced cost among them in w.best, at most max_columns of them.
+   All workers count their columns in found, and unless complete is true,
+   the pool is stopped once max_columns columns have been found. If tiered
+   is true, the tours of most sets are bounded or estimated rather than 
+   solved (see --tiered-pricing), so the columns may be longer than their
+   shortest tours. The lowest
+   reduced cost of the sets walked is kept in w.lowest, and the lowest per
+   crew member in w.lowest_per_crew. A prefix of fewer than 
+   PRICING_SPLIT_DEPTH platforms is not walked, but split into one task per
+   platform that may be appended to it. */
+void price_subtree(const ProblemData &data, const vector<int> &P, const vector<int> &prefix,
+                   PricingWorker &w, int worker, WorkStealingPool<vector<int> > &pool,
+                   atomic<int> &found, int max_columns, bool complete, bool tiered) {
+  int R = data.R, C = data.C;
+  SubsetEnumerator &subsets = w.subsets;
+  subsets.start(prefix);
+  w.lattice.truncate(0);
+  w.walk.truncate(0);
+  for (int k = 0; k + 1 < prefix.size(); k++) {
+    w.lattice.push(P[prefix[k]]);
+    w.walk.push(P[prefix[k]]);
+  }
+
+  // the first set is the prefix itself
+  bool first = true;
+  bool considerSupersets = true;
+  while (!pool.stopped() && (first || subsets.next(considerSupersets))) {
+
+    first = false;
+    considerSupersets = true;
+    const vector<int> &S = subsets.set();
+
+    // S is its predecessor in the walk with the last platform replaced
+    // or appended, so only the last platform of S is new to the lattice
+    // and the walk over the infeasible sets
+    w.lattice.truncate(S.size() - 1);
+    w.lattice.push(S.back());
+    w.walk.truncate(S.size() - 1);
+    w.walk.push(S.back());
+
+    // If S contains a set that is known to be out of range, then we may
+    // exclude S and all its supersets without calculating its tour
+    if (w.walk.contains_infeasible_set()) {
+      considerSupersets = false;
       continue;
+    }
 
-    // This will eventually hold the length of the current TSP tour      
-    double perm_z = d[0][S[0]];
-    
-    // While we're at it, we calculate the smallest value of istar
-    // so that the total distance from points 0, S[0], S[1], ..., S[istar]
-    // is greater than our best known bound. If such an istar exists,
-    // then we may ignore all permutations in S that start with
-    // S[0], S[1], ..., S[istar]    
-    int istar = -1;
-    
-    for (int i = 1; i < n; i++) {
-      perm_z += d[S[i-1]][S[i]];
-      if (perm_z + min_way_back >= z) {
-        istar = i;
-        break;
+    // Calculate TSP tour length. With tiered pricing, the tour of a set is
+    // first bounded by a 1-tree: if the bound is out of range, so is S, and
+    // if it gives no negative reduced cost, S gives no column, and only its
+    // supersets are walked. Otherwise a set that is not in the cache gets
+    // a heuristic tour, and if that is within range and gives a negative 
+    // reduced cost, the column is added at its length. Only the remaining
+    // sets are solved exactly.
+    bool computed = false;
+    bool settled = false;
+    bool no_tour = false;
+    double dS = 0.0;
+    if (tiered && (S.size() >= TIERED_PRICING_MIN_SIZE)) {
+      double bound = one_tree_bound(S, data.d);
+      if ((bound > R) || (bound - subsets.value() >= -1e-8)) {
+        dS = bound;
+        settled = true;
+        no_tour = (bound <= R);
+        TspStats::add(tsp_stats.bound_settled, 1);
+      } else if (cached_tsp(subsets.bitset(), &dS, &computed)) {
+        TspStats::add(tsp_stats.count, 1);
+        TspStats::add(tsp_stats.cache_hit, 1);
+        settled = true;
+      } else {
+        double length = heuristic_tour(S, data.d);
+        if ((length <= R) && (length - subsets.value() < -1e-8)) {
+          dS = length;
+          settled = true;
+          TspStats::add(tsp_stats.heuristic_settled, 1);
+        }
       }
     }
-    
-    // As described above, if istar exists (i.e. it is not -1), we may
-    // prune all permutations starting with S[0], S[1], ..., S[istar],
-    // which is 
-    if (istar >= 0) {
-      sort(S.begin() + istar + 1, S.end(), std::greater<int>());
+    if (!settled)
+      dS = solve_tsp(S, subsets.bitset(), data.d, R + 0.1, &w.lattice, &computed);
+      
+    // If the length of the TSP tour is larger than R, then we may
+    // exclude S and all its supersets
+    if (dS > R) {
+      add_infeasible_set(S, data.d, R);
+      considerSupersets = false;
       continue;
     }
-    
-    perm_z +=  d[S[n-1]][0];
-      
-    if (perm_z < z)
-      z = perm_z;
-  } while (next_permutation(S.begin(), S.end()));
 
-  tsp_solve_time += ClockGetTime() - start;
+    // A route goes into the catalog when its shortest tour first becomes
+    // known in this run: solved, or read from the cache file. Heuristic 
+    // tours are left out, so that the catalog only prices exact lengths.
+    if (computed && (options.pricing == PRICING_CATALOG))
+      route_catalog.insert(S, subsets.bitset(), dS);
+
+    // Calculate reduced cost of the this column
+    double c = dS - subsets.value();
+
+    // if the D[i]'s add up to more than C, we do not need to consider
+    // any supersets of S anymore
+    if (subsets.demand() >= C)
+      considerSupersets = false;
+
+    if (no_tour)
+      c = 0.0;
+    w.lowest = min(w.lowest, c);
+    w.lowest_per_crew = min(w.lowest_per_crew, c / min(subsets.demand(), C));
+
+    // if the reduced cost is negative, keep the column if it is among the
+    // best ones of this worker
+    if (c < -1e-8) {
+      PricedColumn column;
+      subsets.positions(column.z);
+      column.ind.assign(subsets.ind(), subsets.ind() + S.size() + 1);
+      column.val.assign(subsets.val(), subsets.val() + S.size() + 1);
+      column.dS = dS;
+      column.c = c;
+      if ((w.best.size() < max_columns) || by_reduced_cost(column, w.best.back())) {
+        if (w.best.size() == max_columns)
+          w.best.pop_back();
+        w.best.insert(upper_bound(w.best.begin(), w.best.end(), column, by_reduced_cost), column);
+      }
+      if ((++found >= max_columns) && !complete)
+        pool.stop();
+    }
 
-  // Store result in cache  
-  start = ClockGetTime();
-  tsp_cache[hb] = z;
-  tsp_cache_time += ClockGetTime() - start;
-  return z;
+    // Split a short prefix into tasks for its extensions; they are added
+    // in reverse, so that this worker takes them in the order of the walk
+    if (considerSupersets && (S.size() < PRICING_SPLIT_DEPTH)) {
+      subsets.positions(w.z);
+      int last = w.z.back();
+      w.z.push_back(0);
+      for (int k = P.size() - 1; k > last; k--) {
+        w.z.back() = k;
+        pool.push(worker, w.z);
+      }
+      return;
+    }
+  }
 }
 
+/* A label of the labeling algorithm: a path that starts at the airport,
+   visits the platforms in visited and ends at platform node. The crew of
+   the platforms on the path is carried in full, except for at most one
+   platform, partial, which gets the capacity that is left at the end. */
+struct Label {
+  int node;               // last platform of the path
+  int partial;            // platform that gets the remaining capacity, or 0
+  int load;               // crew of the platforms that are carried in full
+  double length;          // length of the path
+  double value;           // sum of D[i] y[i] over those platforms
+  dbitset visited;        // platforms on the path
+  dbitset unreachable;    // platforms on the path or out of its reach
+  bool dominated;         // whether another label dominates this one
+};
+
+/* This function calculates the reduced cost of the flight that returns to
+   the airport at the end of the path of label a. */
+inline double label_reduced_cost(const Label &a, const ProblemData &data, const vector<double> &y) {
+  double value = a.value;
+  if (a.partial != 0)
+    value += y[a.partial] * min(data.D[a.partial], data.C - a.load);
+  return a.length + data.d[a.node][0] - value;
+}
+
+/* This function checks whether label a dominates label b, i.e. whether
+   every extension of b to a flight can be applied to a as well, and gives
+   a flight with a lower reduced cost. Both labels end at the same platform.
+   Every extension carries crew in full, and adds the same load to both. A
+   label with a partial platform keeps a unit of capacity for it, so the
+   extensions of b leave a at least q(b) - q(a) + 1 units. Platforms that a
+   label can no longer reach count as visited, which makes more labels 
+   comparable (Feillet et al., 2004). */
+bool label_dominates(const Label &a, const Label &b, const ProblemData &data, const vector<double> &y) {
+  if ((a.length > b.length + 1e-9) || (a.load > b.load) || ((a.partial == 0) != (b.partial == 0)))
+    return false;
+  double value_a = a.value, value_b = b.value;
+  if (a.partial != 0) {
+    value_a += y[a.partial] * min(data.D[a.partial], b.load - a.load + 1);
+    value_b += y[b.partial] * min(data.D[b.partial], data.C - b.load);
+  }
+  return (value_a >= value_b - 1e-9) && a.unreachable.is_subset_of(b.unreachable);
+}
+
+/* This function looks for flights with a negative reduced cost with a 
+   labeling algorithm for the elementary shortest path problem with 
+   resource constraints, and keeps at most max_columns of them in columns.
+   Starting from the airport, the paths are extended one platform at a time,
+   as long as they can return to the airport within the range R and carry
+   at most C crew. Only platforms with a positive dual value are visited: a
+   platform with a nonpositive dual value can be left out of a flight 
+   without making it longer or its reduced cost higher. For a given set of
+   platforms, the best split of the capacity carries the crew of the 
+   platforms with the highest dual values in full, and gives what is left
+   to one more platform. A path therefore carries the crew of every 
+   platform it visits in full, except for one platform, which may be chosen
+   anywhere on the path, and gets the remaining capacity at the end.
+   The paths that end at the same platform are pruned by dominance (see
+   label_dominates), and a path is dropped when none of its extensions can
+   have a negative reduced cost: the flight is at least as long as the path
+   plus the way back, and the crew that it can still carry is worth at 
+   most the highest dual value within reach. Every path that returns to
+   the airport with a negative reduced cost gives a column. Its shortest
+   tour and the split of the capacity in the order of the dual values make
+   the reduced cost of the column at most that of the path.
+   Like the walk, the search stops once max_columns columns have been 
+   found; if it finds none, there is none. */
+void price_labeling(const ProblemData &data, const vector<double> &y, int max_columns,
+                    vector<PricedColumn> &columns) {
+  int N = data.N, R = data.R, C = data.C;
+  columns.clear();
+
+  // the platforms that may be visited, in order of decreasing dual value
+  vector<int> platforms;
+  for (int i = 1; i <= N; i++)
+    if ((data.D[i] > 0) && (y[i] > 1e-9))
+      platforms.push_back(i);
+  sort(platforms.begin(), platforms.end(), SortBy(y));
+
+  // The labels that have not been dominated are kept in buckets by their
+  // last platform, whether they have a partial platform, and their load,
+  // in order of increasing length. Only the labels in the buckets with at
+  // most the same load can dominate a label, and only the shorter ones.
+  vector<Label> labels;
+  vector<vector<int> > buckets((N + 1) * 2 * (C + 1));
+  deque<int> queue;                            // labels still to be extended
+  vector<dbitset> found;                       // platforms of the columns
+  Label root = { 0, 0, 0, 0.0, 0.0, dbitset(N + 1), dbitset(N + 1), false };
+  labels.push_back(root);
+  queue.push_back(0);
+
+  while (!queue.empty() && (found.size() < max_columns)) {
+    int l = queue.front();
+    queue.pop_front();
+    if (labels[l].dominated)
+      continue;
+
+    for (int k = 0; (k < platforms.size()) && (found.size() < max_columns); k++) {
+      int j = platforms[k];
+      if (labels[l].unreachable.get(j))
+        continue;
+
+      // carry the crew of j in full, or let j take the remaining capacity
+      for (int split = 0; split < 2; split++) {
+        Label b = labels[l];
+        b.node = j;
+        b.length += data.d[labels[l].node][j];
+        b.visited.set(j);
+        b.unreachable.set(j);
+        if (split == 0) {
+          b.load += data.D[j];
+          b.value += data.D[j] * y[j];
+          if ((b.load > C) || ((b.partial != 0) && (b.load >= C)))
+            continue;
+        } else {
+          if ((b.partial != 0) || (b.load >= C))
+            continue;
+          b.partial = j;
+        }
+
+        // mark the platforms that b cannot reach anymore, and bound the
+        // value of the crew it can still carry: the remaining capacity is
+        // filled with the crew of the partial platform and the platforms
+        // within reach, in order of decreasing dual value
+        int capacity = C - b.load;
+        double bound = 0.0;
+        bool partial_counted = (b.partial == 0);
+        for (int m = 0; m < platforms.size(); m++) {
+          int i = platforms[m];
+          if (!partial_counted && (y[b.partial] >= y[i])) {
+            int w = min(capacity, data.D[b.partial]);
+            bound += w * y[b.partial];
+            capacity -= w;
+            partial_counted = true;
+          }
+          if (b.unreachable.get(i))
+            continue;
+          bool fits = (b.partial == 0) ? (b.load < C) : (b.load + data.D[i] < C);
+          if (!fits || (b.length + data.d[j][i] + data.d[i][0] > R)) {
+            b.unreachable.set(i);
+            continue;
+          }
+          int w = min(capacity, data.D[i]);
+          bound += w * y[i];
+          capacity -= w;
+        }
+        if (!partial_counted)
+          bound += min(capacity, data.D[b.partial]) * y[b.partial];
+        if (b.length + data.d[j][0] - b.value - bound >= -1e-8)
+          continue;
+
+        // discard b if it is dominated, and drop the labels it dominates
+        vector<int>* bucket = &buckets[((j * 2) + (b.partial != 0)) * (C + 1)];
+        bool dominated = false;
+        for (int q = 0; (q <= b.load) && !dominated; q++)
+          for (int m = 0; m < bucket[q].size(); m++) {
+            const Label &a = labels[bucket[q][m]];
+            if (a.length > b.length + 1e-9)
+              break;
+            if (label_dominates(a, b, data, y)) {
+              dominated = true;
+              break;
+            }
+          }
+        if (dominated)
+          continue;
+        for (int q = b.load; q <= C; q++) {
+          vector<int> &same = bucket[q];
+          int n = 0;
+          for (int m = 0; m < same.size(); m++) {
+            Label &a = labels[same[m]];
+            if ((a.length >= b.length - 1e-9) && label_dominates(b, a, data, y))
+              a.dominated = true;
+            else
+              same[n++] = same[m];
+          }
+          same.resize(n);
+        }
+        int index = labels.size();
+        vector<int> &same = bucket[b.load];
+        int m = same.size();
+        while ((m > 0) && (labels[same[m - 1]].length > b.length))
+          m--;
+        same.insert(same.begin() + m, index);
+        queue.push_back(index);
+        labels.push_back(b);
+
+        if (label_reduced_cost(b, data, y) < -1e-8) {
+          bool duplicate = false;
+          for (int m = 0; (m < found.size()) && !duplicate; m++)
+            duplicate = (found[m] == b.visited);
+          if (!duplicate)
+            found.push_back(b.visited);
+        }
+      }
+    }
+  }
+
+  // turn the paths into columns
+  vector<int> S;
+  for (int m = 0; m < found.size(); m++) {
+    S.assign(found[m].begin(), found[m].end());
+    sort(S.begin(), S.end(), SortBy(y));
+    PricedColumn column;
+    column.dS = solve_tsp(S, found[m], data.d, R + 0.1);
+    column.ind.resize(S.size() + 1);
+    column.val.resize(S.size() + 1);
+    flight_column(S, data, &column.ind[0], &column.val[0]);
+    column.c = column.dS;
+    for (int k = 1; k <= S.size(); k++)
+      column.c -= column.val[k] * y[column.ind[k]];
+    columns.push_back(column);
+  }
+}
+
+/* This function calculates a lower bound on the LP relaxation from any 
+   dual values y. P holds the platforms with demand, in order of 
+   decreasing dual value, and z is the objective value of the current 
+   model. If exact is true, lowest is the lowest reduced cost of any 
+   flight at y, and lowest_per_crew the lowest reduced cost per crew 
+   member. The Lagrangian bound is sum D[i] y[i] plus the sum of x(j) 
+   times the reduced cost of the flights j of an optimal solution. They
+   carry sum D[i] crew members, and there are at most z divided by the 
+   shortest flight of them, so the sum is at least either number times the
+   corresponding lowest reduced cost.
+   Otherwise, these are bounded: every flight is at least as long as the 
+   way to its platform a farthest from the airport and back, and its other
+   platforms j lie within range of the triangle 0, j, a; the crew it 
+   carries is worth at most the fractional knapsack of C over those 
+   platforms. This also bounds the ratio of the crew value of a flight to
+   its length; the Farley bound divides sum D[i] y[i] by the highest 
+   ratio, which scales y to a feasible dual solution. The largest bound is
+   returned. The bounds without the exact reduced costs are weak, as the 
+   way to the farthest platform is much shorter than most flights. */
+double lagrangian_bound(const ProblemData &data, const vector<double> &y,
+                        const vector<int> &P, double z, bool exact,
+                        double lowest, double lowest_per_crew) {
+  int R = data.R, C = data.C;
+  const DistanceMatrix &d = data.d;
+  double value = 0.0, shortest = numeric_limits<double>::infinity();
+  int sumD = 0;
+  for (int k = 0; k < P.size(); k++) {
+    value += data.D[P[k]] * y[P[k]];
+    sumD += data.D[P[k]];
+    shortest = min(shortest, d[0][P[k]] + d[P[k]][0]);
+  }
+
+  double ratio = 0.0;
+  if (exact) {
+    lowest = min(lowest, 0.0);
+    lowest_per_crew = min(lowest_per_crew, 0.0);
+  } else {
+    lowest = lowest_per_crew = 0.0;
+    ratio = 1.0;
+    for (int m = 0; m < P.size(); m++) {
+      int a = P[m];
+      double da = d[0][a] + d[a][0];
+      if (da > R)
+        continue;
+      int capacity = C;
+      double crew_value = 0.0;
+      for (int k = 0; (k < P.size()) && (capacity > 0) && (y[P[k]] > 0.0); k++) {
+        int j = P[k];
+        if ((j != a) && ((d[0][j] + d[j][0] > da)
+                         || (min(d[0][j] + d[j][a] + d[a][0], d[0][a] + d[a][j] + d[j][0]) > R)))
+          continue;
+        int w = min(capacity, data.D[j]);
+        crew_value += w * y[j];
+        capacity -= w;
+        lowest_per_crew = min(lowest_per_crew, (da - crew_value) / (C - capacity));
+      }
+      lowest = min(lowest, da - crew_value);
+      ratio = max(ratio, crew_value / da);
+    }
+  }
+
+  double flights = min(static_cast<double>(sumD), z / shortest);
+  double bound = value + max(flights * lowest, sumD * lowest_per_crew);
+  if ((ratio > 0.0) && (value > 0.0))
+    bound = max(bound, value / ratio);
+  return bound;
+}
 
 int update_rhs_and_construct_basis(glp_prob* lp, const ProblemData &data)
 {
@@ -424,10 +1677,29 @@ int update_rhs_and_construct_basis(glp_prob* lp, const ProblemData &data)
   // make all other columns nonbasic (on lower bound)
   for (int j = N + 1; j <= glp_get_num_cols(lp); j++)
     glp_set_col_stat(lp, j, GLP_NL);
+
+  return 0;
 }
 
-int run_column_generation(glp_prob* lp, const ProblemData &data, vector<Flight> &xopt) {
-  int N = data.N, R = data.R, C = data.C;
+/* This function solves the LP relaxation of the model by column
+   generation, and stores its solution in xopt. The pricing walk runs on
+   the threads of pool, which the caller keeps for all its solves, so that
+   they are not started again for every solve. Unless construct_basis is
+   false, the simplex method starts from the basis of the single-platform
+   columns. Columns that have been nonbasic with a positive reduced cost 
+   for options.column_age iterations are moved to side_pool (or a pool of
+   this solve, if it is NULL), which is priced before any other routes.
+   Every iteration gives a lower bound on the LP relaxation (see 
+   lagrangian_bound). If tail_off is positive, the procedure stops as soon
+   as the objective value is within this fraction of the best bound. The
+   best bound, if the procedure stopped this way, or else the objective 
+   value of xopt is stored in lower_bound if it is given. */
+int run_column_generation(glp_prob* lp, const ProblemData &data,
+                          WorkStealingPool<vector<int> > &pool, vector<Flight> &xopt,
+                          ostream &log, bool construct_basis = true,
+                          SidePool* side_pool = NULL, double tail_off = 0.0,
+                          double* lower_bound = NULL) {
+  int N = data.N, C = data.C;
   
   // Set up some arrays that will be in the column generation procedure
   // There have been taken outside of the loop for efficiency reasons.
@@ -437,20 +1709,57 @@ int run_column_generation(glp_prob* lp, const ProblemData &data, vector<Flight>
     if (data.D[i] > 0)
       Pindex.push_back(i);
       
-  int ind[N+1];
-  double val[N+1];
+  vector<int> ind(N+1);
+  vector<double> val(N+1);
   vector<double> y(N+1);
-  vector<int> pi;
   vector<int> S;
-  pi.reserve(N);
   S.reserve(N);
+  vector<RouteCatalog::Candidate> candidates;
+  vector<PricedColumn> columns;
+
+  // Number of iterations that each column N + 1, N + 2, ... has been
+  // nonbasic with a positive reduced cost, and the pool of the columns 
+  // that have been moved out of the model
+  vector<int> age;
+  SidePool local_pool(N+1);
+  SidePool &pool_out = (side_pool != NULL) ? *side_pool : local_pool;
+  vector<SidePool::Candidate> pool_candidates;
+  vector<size_t> taken;
+  vector<int> del_cols;
+  int moved_out = 0, taken_back = 0;
+
+  // Dual values of the LP, of the previous iteration, and of the stability
+  // center of the smoothing (see --smoothing)
+  vector<double> y_out(N+1), y_previous(N+1), y_center(N+1);
+  bool has_center = false;
+  double best_reduced_cost = 0.0;
+  int total_mispriced = 0;
+  double best_bound = -numeric_limits<double>::infinity();
+  bool stopped = false;
+
+  // With a tail-off gap, every iteration prices with a complete walk, 
+  // which gives the lowest reduced cost and with it a tight lower bound
+  bool complete = (tail_off > 0.0);
+  bool exact = false;
+  double lowest = 0.0, lowest_per_crew = 0.0;
+  int trace_solve = cg_trace.is_open() ? ++cg_trace_solves : 0;
+  bool show_bound = (options.cg_gap > 0.0) || (trace_solve > 0);
+
+  // Set up the workers of the pricing walk; their threads count their TSP
+  // calls for the scope of this thread
+  TspStatsScope* scope = tsp_stats.scope;
+  vector<unique_ptr<PricingWorker> > workers;
+  for (int k = 0; k < pool.size(); k++)
+    workers.push_back(unique_ptr<PricingWorker>(new PricingWorker(data, Pindex, y)));
 
   // Set up GLPK simplex parameters
   glp_smcp parm;
   glp_init_smcp(&parm);
   parm.msg_lev = GLP_MSG_ERR;
   
-  update_rhs_and_construct_basis(lp, data);
+  if (construct_basis)
+    update_rhs_and_construct_basis(lp, data);
+  age.assign(glp_get_num_cols(lp) - N, 0);
 
   // Start the column generation procedure
   bool optimal = false;
@@ -458,86 +1767,238 @@ int run_column_generation(glp_prob* lp, const ProblemData &data, vector<Flight>
   while ((!optimal) && (iteration < ITERATION_LIMIT)) {
     // Solve the current linear optimization model
     glp_simplex(lp, &parm);
+    double z = glp_get_obj_val(lp);
 
-    // Output the objective value
+    // Output the objective value, and the lower bound if it is used
     if ((iteration % 25) == 0) {
-      cout << "Iteration " << setw(6) << iteration
-           << ", objective = " << fixed << setprecision(OBJ_OUTPUT_PRECISION) 
-           << glp_get_obj_val(lp) << endl;
+      log << "Iteration " << setw(6) << iteration
+           << ", objective = " << fixed << setprecision(OBJ_OUTPUT_PRECISION) << z;
+      if (show_bound)
+        log << ", lower bound = " << best_bound;
+      log << endl;
+    }
+
+    // Stop if the objective value is close enough to the bound
+    if ((tail_off > 0.0) && (z - best_bound <= tail_off * fabs(z))) {
+      stopped = true;
+      break;
     }
 
     // Get dual values
     for (int i = 1; i <= N; i++)
-      y[i] = glp_get_row_dual(lp, i);
-
-    // Sort platforms in descending order of dual variables
-    sort(Pindex.begin(), Pindex.end(), SortBy(y));
+      y_out[i] = glp_get_row_dual(lp, i);
+
+    // Age the columns, and move the old ones to the side pool. They are
+    // nonbasic, so the basis stays valid.
+    if (options.column_age > 0) {
+      del_cols.assign(1, 0);
+      for (int j = N + 1; j <= glp_get_num_cols(lp); j++) {
+        int &a = age[j - N - 1];
+        if ((glp_get_col_stat(lp, j) != GLP_BS) && (glp_get_col_dual(lp, j) > 1e-8))
+          a++;
+        else
+          a = 0;
+        if (a >= options.column_age) {
+          int len = glp_get_mat_col(lp, j, &ind[0], &val[0]);
+          pool_out.insert(vector<int>(ind.begin() + 1, ind.begin() + len + 1),
+                          glp_get_obj_coef(lp, j));
+          del_cols.push_back(j);
+        }
+      }
+      if (del_cols.size() > 1) {
+        glp_del_cols(lp, del_cols.size()-1, &del_cols.front());
+        moved_out += del_cols.size() - 1;
+        int k = 0;
+        for (int j = 0; j < age.size(); j++)
+          if (age[j] < options.column_age)
+            age[k++] = age[j];
+        age.resize(k);
+      }
+    }
 
-    // Construct platform subsets S to generate columns
-    bool   considerSupersets = true;
+    // Price at the smoothed dual values y = alpha y_center + (1 - alpha) 
+    // y_out, and add the columns that have a negative reduced cost at y_out
+    // as well. If there are none (a misprice), alpha is lowered and the
+    // pricing is repeated, until alpha = 0, where the pricing is exact.
+    double alpha = has_center ? options.smoothing : 0.0;
     int    columnsAdded = 0;
-    pi.clear();
-    while (next_lex_subset(pi, Pindex.size(), considerSupersets)
-           && (columnsAdded < MAX_COLUMNS_PER_ITERATION)) {
-
-      considerSupersets = true;
+    int    mispriced = 0;
+    for (;;) {
+      for (int i = 1; i <= N; i++)
+        y[i] = alpha * y_center[i] + (1.0 - alpha) * y_out[i];
+
+      // Sort platforms in descending order of dual variables
+      sort(Pindex.begin(), Pindex.end(), SortBy(y));
+
+      // Look for columns among the routes in the side pool first, then 
+      // among the routes that have been enumerated before. Only when there
+      // are none, the platform subsets are enumerated again.
+      columns.clear();
+      exact = false;
+      taken.clear();
+      if (!complete)
+        pool_out.price(y, data.D, C, MAX_COLUMNS_PER_ITERATION, 1e-8, pool_candidates);
+      else
+        pool_candidates.clear();
+      for (int k = 0; k < pool_candidates.size(); k++) {
+        pool_out.route(pool_candidates[k].route, S);
+        sort(S.begin(), S.end(), SortBy(y));
+        PricedColumn column;
+        column.ind.resize(S.size() + 1);
+        column.val.resize(S.size() + 1);
+        flight_column(S, data, &column.ind[0], &column.val[0]);
+        column.dS = pool_out.length(pool_candidates[k].route);
+        column.c = pool_candidates[k].reduced_cost;
+        columns.push_back(column);
+        taken.push_back(pool_candidates[k].route);
+      }
 
-      // Construct set S
-      S.clear();
-      for (int i = 0; i < pi.size(); i++)
-        S.push_back(Pindex[pi[i]]);
+      if ((options.pricing == PRICING_CATALOG) && !complete && columns.empty()) {
+        route_catalog.price(y, data.D, C, MAX_COLUMNS_PER_ITERATION, 1e-8, candidates);
+        for (int k = 0; k < candidates.size(); k++) {
+          route_catalog.route(candidates[k].route, S);
+          sort(S.begin(), S.end(), SortBy(y));
+          PricedColumn column;
+          column.ind.resize(S.size() + 1);
+          column.val.resize(S.size() + 1);
+          flight_column(S, data, &column.ind[0], &column.val[0]);
+          column.dS = route_catalog.length(candidates[k].route);
+          column.c = candidates[k].reduced_cost;
+          columns.push_back(column);
+        }
+      }
 
-      // Calculate TSP tour length
-      double dS = solve_tsp(S, data.d, R + 0.1);
-      
-      // If the length of the TSP tour is larger than R, then we may
-      // exclude S and all its supersets
-      if (dS > R) {
-        considerSupersets = false;
-        continue;
+      // Find the best flights directly with the labeling algorithm
+      if ((options.pricing == PRICING_LABELING) && !complete) {
+        if (columns.empty())
+          price_labeling(data, y, MAX_COLUMNS_PER_ITERATION, columns);
       }
 
-      // Calculate reduced cost of the this column
-      double c = dS;                        // reduced cost
-      int Cremaining = C;                   // remaining capacity
-      int sumDi = 0;                        // sum of D[i] for i in S
-      for (int j = 0; j < S.size(); j++) {
-        int i = S[j];                       // we are considering platform P(i)
-        int w = min(Cremaining, data.D[i]); 
-        ind[j+1] = i;
-        val[j+1] = w;
-        Cremaining -= w;                    // update remaining capacity
-        c  -= w * y[i];                     // update reduced cost
-        sumDi += data.D[i];                 // update sum of D[i] for i in S
+      // Construct platform subsets S to generate columns. The walk is split
+      // into subtrees, starting with one per first platform, which are
+      // divided over the workers; each worker takes its own in walk order.
+      // With tiered pricing, a walk that finds no columns is repeated with
+      // the exact tours, which proves that there are none.
+      else if (columns.empty()) {
+        for (bool tiered = options.tiered_pricing && !complete; ; tiered = false) {
+          atomic<int> found(0);
+          for (int k = Pindex.size() - 1; k >= 0; k--)
+            pool.push(k % pool.size(), vector<int>(1, k));
+          pool.run([&](int worker, const vector<int> &prefix) {
+            tsp_enter_scope(scope);
+            price_subtree(data, Pindex, prefix, *workers[worker], worker, pool,
+                          found, MAX_COLUMNS_PER_ITERATION, complete, tiered);
+          });
+
+          // Merge the best columns of the workers, and keep the best of 
+          // them in the order of the walk. If the walk was not stopped and
+          // solved all tours, it has seen every flight.
+          exact = !tiered && (complete || (found < MAX_COLUMNS_PER_ITERATION));
+          lowest = lowest_per_crew = 0.0;
+          for (int k = 0; k < workers.size(); k++) {
+            columns.insert(columns.end(), workers[k]->best.begin(), workers[k]->best.end());
+            workers[k]->best.clear();
+            lowest = min(lowest, workers[k]->lowest);
+            lowest_per_crew = min(lowest_per_crew, workers[k]->lowest_per_crew);
+            workers[k]->lowest = workers[k]->lowest_per_crew = 0.0;
+          }
+          sort(columns.begin(), columns.end(), by_reduced_cost);
+          if (columns.size() > MAX_COLUMNS_PER_ITERATION)
+            columns.resize(MAX_COLUMNS_PER_ITERATION);
+          sort(columns.begin(), columns.end(), by_walk_order);
+          if (!columns.empty() || !tiered)
+            break;
+        }
       }
 
-      // if the D[i]'s add up to more than C, we do not need to consider
-      // any supersets of S anymore
-      if (sumDi >= C)
-        considerSupersets = false;
-
-      // if the reduced cost is negative, add the column
-      if (c < -1e-8) {
-        // add the column
-        int j = glp_add_cols(lp, 1);
-        glp_set_mat_col(lp, j, S.size(), ind, val);
-        glp_set_obj_coef(lp, j, dS);
-        glp_set_col_bnds(lp, j, GLP_LO, 0.0, 0.0);
+      // Add the columns; with smoothing, only those with a negative 
+      // reduced cost at y_out. The columns from the side pool come first,
+      // and the routes of those that are added are erased from the pool.
+      double best = 0.0;
+      int added_from_pool = 0;
+      for (int k = 0; k < columns.size(); k++) {
+        PricedColumn &column = columns[k];
+        best = min(best, column.c);
+        if (alpha > 0.0) {
+          double c = column.dS;
+          for (int j = 1; j < column.ind.size(); j++)
+            c -= column.val[j] * y_out[column.ind[j]];
+          if (c >= -1e-8)
+            continue;
+        }
+        add_column(lp, column.ind.size() - 1, &column.ind[0], &column.val[0], column.dS);
+        age.push_back(0);
         columnsAdded++;
+        if (k < taken.size())
+          taken[added_from_pool++] = taken[k];
       }
+      taken.resize(added_from_pool);
+      pool_out.erase(taken);
+      taken_back += added_from_pool;
+
+      // The stability center moves to the dual values that were priced.
+      // (Wentges moves it only when the Lagrangian bound improves, but the
+      // pricing stops after MAX_COLUMNS_PER_ITERATION columns, so it does
+      // not give the lowest reduced cost that the bound needs.)
+      y_center = y;
+      has_center = true;
+      best_reduced_cost = best;
+
+      if ((columnsAdded > 0) || (alpha == 0.0))
+        break;
+      mispriced++;
+      alpha = max(0.0, 1.0 - (mispriced + 1) * (1.0 - options.smoothing));
     }
+    total_mispriced += mispriced;
+    // Without columns, no flight has a negative reduced cost
+    if (columns.empty() && !exact) {
+      exact = true;
+      lowest = lowest_per_crew = 0.0;
+    }
+    best_bound = max(best_bound, lagrangian_bound(data, y, Pindex, z, exact,
+                                                  lowest, lowest_per_crew));
+
+    // Write the iteration to the trace: the objective, the smoothing, how
+    // far the dual values moved since the last iteration and are from the
+    // stability center, the best reduced cost found, and the lower bound
+    if (trace_solve > 0) {
+      double step = 0.0, distance = 0.0;
+      for (int i = 1; i <= N; i++) {
+        step += sqr(y_out[i] - y_previous[i]);
+        distance += sqr(y_center[i] - y_out[i]);
+      }
+      lock_guard<mutex> guard(cg_trace_lock);
+      cg_trace << trace_solve << "," << iteration << "," 
+               << setprecision(OBJ_OUTPUT_PRECISION) << fixed << glp_get_obj_val(lp) << ","
+               << alpha << "," << mispriced << "," << columnsAdded << ","
+               << sqrt(step) << "," << sqrt(distance) << "," << best_reduced_cost << ","
+               << best_bound << "\n";
+    }
+    y_previous = y_out;
+
     optimal = (columnsAdded == 0);
     iteration++;
   }
 
+  if (options.smoothing > 0.0)
+    log << "Dual smoothing: " << total_mispriced << " mispricings" << endl;
+  if (options.column_age > 0)
+    log << "Side pool: " << moved_out << " columns moved out, " << taken_back 
+        << " taken back, " << pool_out.size() << " in the pool" << endl;
+
   // Output the objective value
   if (optimal) {
-      cout << "Optimal solution found after " << iteration
+      log << "Optimal solution found after " << iteration
            << " iterations, objective value = " 
            << fixed << setprecision(OBJ_OUTPUT_PRECISION) << glp_get_obj_val(lp)
            << endl;
+  } else if (stopped) {
+      log << "Column generation stopped after " << iteration
+           << " iterations, objective value = " 
+           << fixed << setprecision(OBJ_OUTPUT_PRECISION) << glp_get_obj_val(lp)
+           << ", lower bound = " << best_bound << endl;
   } else {
-      cout << "Too many iterations. Optimization terminated after "
+      log << "Too many iterations. Optimization terminated after "
            << iteration << "iterations, objective value = "
            << fixed << setprecision(OBJ_OUTPUT_PRECISION) << glp_get_obj_val(lp) << endl;
   }
@@ -551,7 +2012,7 @@ int run_column_generation(glp_prob* lp, const ProblemData &data, vector<Flight>
     // continue to the column    
     if (x < 1e-8) continue;
     
-    int len = glp_get_mat_col(lp, j, ind, val);
+    int len = glp_get_mat_col(lp, j, &ind[0], &val[0]);
     
     Flight f;
     f.x = x;
@@ -561,28 +2022,194 @@ int run_column_generation(glp_prob* lp, const ProblemData &data, vector<Flight>
       f.w[ind[i]] = val[i];
     xopt.push_back(f);
   }
+  if (lower_bound != NULL)
+    *lower_bound = stopped ? best_bound : solution_objective(xopt);
   return 0;
 }
 
+/* This function stores the columns of the model, except the N single-
+   platform columns, and the basis in pool. */
+void export_columns(glp_prob* lp, const ProblemData &data, ColumnPool &pool) {
+  int N = data.N;
+  vector<int> ind(N+1);
+  vector<double> val(N+1);
+
+  pool.clear();
+  pool.N = N;
+  for (int i = 1; i <= N; i++)
+    pool.row_status.push_back(glp_get_row_stat(lp, i));
+  for (int j = 1; j <= N; j++)
+    pool.single_status.push_back(glp_get_col_stat(lp, j));
+  for (int j = N + 1; j <= glp_get_num_cols(lp); j++) {
+    ColumnPool::Column column;
+    int len = glp_get_mat_col(lp, j, &ind[0], &val[0]);
+    for (int k = 1; k <= len; k++) {
+      column.platforms.push_back(ind[k]);
+      column.w.push_back(static_cast<int>(val[k] + 0.5));
+    }
+    column.length = glp_get_obj_coef(lp, j);
+    column.status = glp_get_col_stat(lp, j);
+    pool.columns.push_back(column);
+  }
+}
+
+/* This function adds the columns of pool, which was exported by a solve
+   with other demands, to a model without columns. A column that carries 
+   more crew to a platform than its new demand is recomputed: the capacity
+   is given to its platforms in order of their old share of it. Columns 
+   through platforms without demand are dropped. The basis of the pool is 
+   then restored, with the recomputed and dropped columns nonbasic; if it 
+   is not a valid basis for the new model, the basis of the single-platform
+   columns is used instead. Returns whether the basis was restored. */
+bool import_columns(glp_prob* lp, const ProblemData &data, const ColumnPool &pool,
+                    ostream &log) {
+  int N = data.N, C = data.C;
+  vector<int> ind(N+1);
+  vector<double> val(N+1);
+  vector<int> S;
+
+  update_rhs_and_construct_basis(lp, data);
+  int kept = 0, recomputed = 0, dropped = 0;
+  for (int j = 0; j < pool.columns.size(); j++) {
+    const ColumnPool::Column &column = pool.columns[j];
+    bool valid = true, served = true;
+    int total = 0;
+    for (int k = 0; k < column.platforms.size(); k++) {
+      int i = column.platforms[k];
+      valid = valid && (column.w[k] <= data.D[i]);
+      served = served && (data.D[i] > 0);
+      total += column.w[k];
+    }
+    if (!served || column.platforms.empty()) {
+      dropped++;
+      continue;
+    }
+
+    int status = GLP_NL;
+    if (valid && (total <= C)) {
+      for (int k = 0; k < column.platforms.size(); k++) {
+        ind[k+1] = column.platforms[k];
+        val[k+1] = column.w[k];
+      }
+      status = column.status;
+      kept++;
+    } else {
+      vector<int> order(column.platforms.size());
+      for (int k = 0; k < order.size(); k++)
+        order[k] = k;
+      stable_sort(order.begin(), order.end(), 
+                  [&column](int a, int b) { return column.w[a] > column.w[b]; });
+      S.clear();
+      for (int k = 0; k < order.size(); k++)
+        S.push_back(column.platforms[order[k]]);
+      flight_column(S, data, &ind[0], &val[0]);
+      recomputed++;
+    }
+    add_column(lp, column.platforms.size(), &ind[0], &val[0], column.length);
+    glp_set_col_stat(lp, glp_get_num_cols(lp), status);
+    if (options.pricing == PRICING_CATALOG)
+      route_catalog.insert(column.platforms, column.length);
+  }
+
+  for (int i = 1; i <= N; i++) {
+    glp_set_row_stat(lp, i, pool.row_status[i-1]);
+    glp_set_col_stat(lp, i, pool.single_status[i-1]);
+  }
+  bool restored = (glp_warm_up(lp) == 0);
+  if (!restored)
+    update_rhs_and_construct_basis(lp, data);
+
+  log << "Warm start: " << kept << " columns kept, " << recomputed << " recomputed, "
+      << dropped << " dropped, basis " << (restored ? "restored" : "not valid") << endl;
+  return restored;
+}
+
 int solve_LP_relaxation(const ProblemData &data, vector<Flight> &xopt) {
   int N = data.N, C = data.C, R = data.R;
   
   // Construct LP model
   glp_prob* lp = create_lp(data);
-  run_column_generation(lp, data, xopt);
+  WorkStealingPool<vector<int> > pool(options.threads);
+  run_column_generation(lp, data, pool, xopt, cout);
 
   // Clean up
   free_lp(lp);
   return 0;
 }
 
-int round_solution(ProblemData data, vector<Flight> &xopt, double *z_relax) {
+/* This class holds the objective value of the best rounded solution 
+   found by any trial so far, and whether the trials may stop. */
+class Incumbent {
+ public:
+  Incumbent() : z_(numeric_limits<double>::infinity()), done_(false) { }
+
+  double value() const { return z_; }
+
+  // Offer the objective value of a rounded solution; returns whether it
+  // is better than the best one so far.
+  bool update(double z) {
+    double best = z_;
+    while (z < best)
+      if (z_.compare_exchange_weak(best, z))
+        return true;
+    return false;
+  }
+
+  // whether the trials that are still running may stop
+  bool done() const { return done_; }
+  void set_done() { done_ = true; }
+
+ private:
+  atomic<double> z_;
+  atomic<bool> done_;
+};
+
+/* This function chooses the flight of the LP solution xopt that the
+   round-off algorithm fixes next. */
+int pick_column(const vector<Flight> &xopt, RoundingStrategy strategy, mt19937_64 &rng) {
+  if (strategy == ROUNDING_RANDOM)
+    return rng() % xopt.size();
+  int best = 0;
+  double best_key = -1.0;
+  for (int j = 0; j < xopt.size(); j++) {
+    double x = xopt[j].x;
+    double key = (strategy == ROUNDING_LARGEST) ? x : x - floor(x + 1e-9);
+    if (key > best_key) {
+      best = j;
+      best_key = key;
+    }
+  }
+  return best;
+}
+
+/* This function rounds the LP relaxation to an integer solution by fixing
+   a flight of the LP solution, chosen with the given strategy, and solving
+   the LP again for the remaining demand, until all demand is met. Random
+   choices are made with rng, and the progress is written to log.
+   If incumbent is given, the rounding is abandoned as soon as the flights
+   fixed so far plus the LP relaxation of the remaining demand cost at 
+   least as much as the incumbent, or once the incumbent is done. The 
+   function returns 0 if all demand was met, and 1 if it was abandoned.
+   If warm_start is given, the LP relaxation starts from its columns and
+   basis; if columns is given, the columns and basis of the LP relaxation
+   are stored in it. */
+int round_solution(ProblemData data, vector<Flight> &xopt, double *z_relax,
+                   RoundingStrategy strategy, mt19937_64 &rng, ostream &log,
+                   const Incumbent* incumbent = NULL,
+                   const ColumnPool* warm_start = NULL, ColumnPool* columns = NULL) {
     
   int N = data.N, C = data.C;
   xopt.clear();
+  vector<int> ind(N+1);
+  vector<double> val(N+1);
 
-  // Construct LP model
+  // Construct LP model, the side pool of the columns taken out of it, and
+  // the threads of the pricing walk, which are used by all rounds
   glp_prob* lp = create_lp(data);
+  if (warm_start != NULL)
+    import_columns(lp, data, *warm_start, log);
+  SidePool side_pool(N+1);
+  WorkStealingPool<vector<int> > pool(options.threads);
 
   int sumD = 0;
   for (int i = 1; i <= N; i++)
@@ -590,20 +2217,38 @@ int round_solution(ProblemData data, vector<Flight> &xopt, double *z_relax) {
     
   int iteration = 1;
   while (sumD > 0) {
-    cout << "*** Round-off algorithm, iteration " << iteration 
+    log << "*** Round-off algorithm, iteration " << iteration 
          << " (remaining total demand=" << sumD << ")" << endl;
 
+    // The LP relaxation is solved to optimality; the later rounds may stop
+    // once they are close enough to their lower bound (see --cg-gap)
     vector<Flight> lp_xopt;
-    run_column_generation(lp, data, lp_xopt);
+    double lp_bound;
+    run_column_generation(lp, data, pool, lp_xopt, log, (iteration > 1) || (warm_start == NULL),
+                          &side_pool, (iteration > 1) ? options.cg_gap : 0.0, &lp_bound);
     if (iteration == 1)
     {
       *z_relax = solution_objective(lp_xopt);
-      cout << "LP-relaxation objective value: "
+      log << "LP-relaxation objective value: "
            << fixed << setprecision(OBJ_OUTPUT_PRECISION) << *z_relax << endl;
+      if (columns != NULL)
+        export_columns(lp, data, *columns);
+    }
+
+    // give up if this cannot lead to a better solution than the incumbent
+    if (incumbent != NULL) {
+      double bound = solution_objective(xopt) + lp_bound;
+      if (incumbent->done() || (bound >= incumbent->value() - 1e-6)) {
+        log << "Round-off abandoned: lower bound " 
+            << fixed << setprecision(OBJ_OUTPUT_PRECISION) << bound 
+            << ", best solution " << incumbent->value() << endl;
+        free_lp(lp);
+        return 1;
+      }
     }
     
-    // pick an arbitrary column of lp_xopt that has positive value
-    int j = rand() % lp_xopt.size();
+    // pick a column of lp_xopt that has positive value
+    int j = pick_column(lp_xopt, strategy, rng);
     Flight f = lp_xopt[j];
 
     // round x value
@@ -617,18 +2262,21 @@ int round_solution(ProblemData data, vector<Flight> &xopt, double *z_relax) {
       glp_set_row_bnds(lp, i, GLP_FX, data.D[i], data.D[i]);
     }
 
-    // delete all infeasible columns
+    // delete all infeasible columns; their routes are kept in the side
+    // pool, where the capacity is split again for the remaining demand
+    side_pool.erase_unserved(data.D);
     vector<int> del_cols(0);
     for (int j = N+1; j <= glp_get_num_cols(lp); j++)
     {
       // check if column j is feasible
-      int ind[N];
-      double val[N];
-      int len = glp_get_mat_col(lp, j, ind, val);
+      int len = glp_get_mat_col(lp, j, &ind[0], &val[0]);
       for (int k = 1; k <= len; k++)
         if (val[k] > data.D[ind[k]])
         {
           del_cols.push_back(j);
+          if (options.column_age > 0)
+            side_pool.insert(vector<int>(ind.begin() + 1, ind.begin() + len + 1),
+                             glp_get_obj_coef(lp, j));
           break;
         }
     }
@@ -645,57 +2293,606 @@ int round_solution(ProblemData data, vector<Flight> &xopt, double *z_relax) {
 }
 
 
+/* This function outputs the command line syntax */
+void usage() {
+  cerr << "Usage: helicopter [options] <platform file> <demand file>" << endl
+       << "       helicopter --batch [options] <platform file> <demand file>..." << endl
+       << "Options:" << endl
+       << "  --cache-memory=<MB>    limit the memory used by the TSP cache" << endl
+       << "  --cache-entries=<n>    limit the number of tours in the TSP cache" << endl
+       << "  --cache-file=<path>    keep the TSP cache in this file between runs" << endl
+       << "  --pricing=<method>     column generation: catalog (default), walk or labeling" << endl
+       << "  --threads=<n>          threads of the pricing walk (0: one per core)" << endl
+       << "  --trials=<n>           number of rounding trials (default 16)" << endl
+       << "  --trial-threads=<n>    rounding trials run at the same time (0: one per core;" << endl
+       << "                         the portfolio runs one per core by default)" << endl
+       << "  --seed=<n>             random seed, for reproducible runs" << endl
+       << "  --rounding=<strategy>  random (default), largest, fractional or portfolio" << endl
+       << "  --gap=<percent>        stop once a solution is within this gap" << endl
+       << "  --batch                solve every demand file (or pattern) given" << endl
+       << "  --batch-threads=<n>    scenarios solved at the same time (0: one per core)" << endl
+       << "  --load-columns=<path>  start column generation from the columns in this file" << endl
+       << "  --save-columns=<path>  save the columns of the LP relaxation to this file" << endl
+       << "  --warm-start           start each scenario from the columns of the previous one" << endl
+       << "  --smoothing=<alpha>    smooth the dual values toward a stability center" << endl
+       << "  --cg-trace=<path>      write every column generation iteration to a CSV file" << endl
+       << "  --column-age=<n>       iterations before an unused column leaves the model" << endl
+       << "  --cg-gap=<percent>     stop the LPs of the round-off steps within this gap" << endl
+       << "  --tiered-pricing       bound and estimate tours before solving them" << endl;
+}
+
+/* This function reads a percentage of at least 0 and less than 100 from
+   text, and stores it in value as a fraction. It returns false if text is
+   not such a number. */
+bool parse_percentage(const char* text, double &value) {
+  char* end;
+  double percentage = strtod(text, &end);
+  if ((end == text) || (*end != '\0') || !(percentage >= 0.0) || (percentage >= 100.0))
+    return false;
+  value = percentage / 100.0;
+  return true;
+}
+
+/* This function parses the command line options. The remaining arguments
+   are stored in args. */
+bool parse_options(int argc, char* argv[], Options &options, vector<string> &args) {
+  static const struct option long_options[] = {
+    { "cache-memory",  required_argument, NULL, 'm' },
+    { "cache-entries", required_argument, NULL, 'e' },
+    { "cache-file",    required_argument, NULL, 'f' },
+    { "pricing",       required_argument, NULL, 'p' },
+    { "threads",       required_argument, NULL, 't' },
+    { "trials",        required_argument, NULL, 'n' },
+    { "trial-threads", required_argument, NULL, 'j' },
+    { "seed",          required_argument, NULL, 's' },
+    { "rounding",      required_argument, NULL, 'r' },
+    { "gap",           required_argument, NULL, 'g' },
+    { "batch",         no_argument,       NULL, 'b' },
+    { "batch-threads", required_argument, NULL, 'k' },
+    { "load-columns",  required_argument, NULL, 'l' },
+    { "save-columns",  required_argument, NULL, 'o' },
+    { "warm-start",    no_argument,       NULL, 'w' },
+    { "smoothing",     required_argument, NULL, 'a' },
+    { "cg-trace",      required_argument, NULL, 'c' },
+    { "column-age",    required_argument, NULL, 'x' },
+    { "cg-gap",        required_argument, NULL, 'y' },
+    { "tiered-pricing", no_argument,      NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int c;
+  bool has_trial_threads = false;
+  while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+    switch (c) {
+      case 'm':
+        options.cache_memory = static_cast<size_t>(atof(optarg) * 1048576.0);
+        break;
+      case 'e':
+        options.cache_entries = strtoul(optarg, NULL, 10);
+        break;
+      case 'f':
+        options.cache_file = optarg;
+        break;
+      case 'p':
+        if (strcmp(optarg, "walk") == 0)
+          options.pricing = PRICING_WALK;
+        else if (strcmp(optarg, "catalog") == 0)
+          options.pricing = PRICING_CATALOG;
+        else if (strcmp(optarg, "labeling") == 0)
+          options.pricing = PRICING_LABELING;
+        else {
+          cerr << "Unknown pricing method " << optarg << endl;
+          return false;
+        }
+        break;
+      case 't':
+        options.threads = atoi(optarg);
+        if (options.threads <= 0)
+          options.threads = max(thread::hardware_concurrency(), 1u);
+        break;
+      case 'n':
+        options.trials = atoi(optarg);
+        if (options.trials <= 0) {
+          cerr << "The number of trials must be positive" << endl;
+          return false;
+        }
+        break;
+      case 'j':
+        options.trial_threads = atoi(optarg);
+        if (options.trial_threads <= 0)
+          options.trial_threads = max(thread::hardware_concurrency(), 1u);
+        has_trial_threads = true;
+        break;
+      case 's':
+        options.seed = strtoull(optarg, NULL, 10);
+        options.has_seed = true;
+        break;
+      case 'r':
+        if (strcmp(optarg, "random") == 0)
+          options.rounding = ROUNDING_RANDOM;
+        else if (strcmp(optarg, "largest") == 0)
+          options.rounding = ROUNDING_LARGEST;
+        else if (strcmp(optarg, "fractional") == 0)
+          options.rounding = ROUNDING_FRACTIONAL;
+        else if (strcmp(optarg, "portfolio") == 0)
+          options.rounding = ROUNDING_PORTFOLIO;
+        else {
+          cerr << "Unknown rounding strategy " << optarg << endl;
+          return false;
+        }
+        break;
+      case 'g':
+        if (!parse_percentage(optarg, options.gap)) {
+          cerr << "The gap must be a percentage of at least 0 and less than 100" << endl;
+          return false;
+        }
+        break;
+      case 'b':
+        options.batch = true;
+        break;
+      case 'k':
+        options.batch_threads = atoi(optarg);
+        if (options.batch_threads <= 0)
+          options.batch_threads = max(thread::hardware_concurrency(), 1u);
+        break;
+      case 'l':
+        options.load_columns = optarg;
+        break;
+      case 'o':
+        options.save_columns = optarg;
+        break;
+      case 'w':
+        options.warm_start = true;
+        break;
+      case 'a':
+        options.smoothing = atof(optarg);
+        if ((options.smoothing < 0.0) || (options.smoothing >= 1.0)) {
+          cerr << "The smoothing must be at least 0 and less than 1" << endl;
+          return false;
+        }
+        break;
+      case 'c':
+        options.cg_trace = optarg;
+        break;
+      case 'x':
+        options.column_age = atoi(optarg);
+        if (options.column_age < 0) {
+          cerr << "The column age must be nonnegative" << endl;
+          return false;
+        }
+        break;
+      case 'y':
+        if (!parse_percentage(optarg, options.cg_gap)) {
+          cerr << "The column generation gap must be a percentage of at least 0 and less than 100" << endl;
+          return false;
+        }
+        break;
+      case 'h':
+        options.tiered_pricing = true;
+        break;
+      default:
+        return false;
+    }
+  }
+  // The members of the portfolio run at the same time, one per core, 
+  // unless the number of trial threads is given
+  if ((options.rounding == ROUNDING_PORTFOLIO) && !has_trial_threads)
+    options.trial_threads = max(thread::hardware_concurrency(), 1u);
+  for (int i = optind; i < argc; i++)
+    args.push_back(argv[i]);
+  return true;
+}
+
+/* Structure for storing the outcome of a rounding trial */
+struct TrialResult {
+  uint64_t seed;              // seed of the random numbers of the trial
+  RoundingStrategy strategy;  // how the trial picked the flights to fix
+  bool started;               // false if the run stopped before the trial
+  bool abandoned;             // whether the trial was given up
+  vector<Flight> xopt;        // rounded solution
+  double z_relax;             // objective value of the LP relaxation
+  double z_round;             // objective value of the rounded solution
+  double time;                // wall clock time, in seconds
+};
+
+/* This function calculates the seed of a trial from the seed of the run,
+   with the SplitMix64 generator, so that the trials get unrelated random
+   numbers. */
+uint64_t trial_seed(uint64_t seed, int trial) {
+  uint64_t z = seed + trial * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* This function returns the name of a rounding strategy */
+const char* strategy_name(RoundingStrategy strategy) {
+  switch (strategy) {
+    case ROUNDING_LARGEST:    return "largest";
+    case ROUNDING_FRACTIONAL: return "fractional";
+    case ROUNDING_PORTFOLIO:  return "portfolio";
+    default:                  return "random";
+  }
+}
+
+/* This function runs a rounding trial and writes its output to log. The
+   result is offered to the incumbent, which is marked done once it is
+   within the gap given by --gap. In the portfolio, the trials are also
+   abandoned when they cannot beat the incumbent. The LP relaxation starts
+   from warm_start if it is given, and trial 1 stores its columns in
+   columns if that is given. */
+void run_trial(const ProblemData &data, int trial, Incumbent &incumbent,
+               TrialResult &result, ostream &log,
+               const ColumnPool* warm_start, ColumnPool* columns) {
+  uint64_t start = TimerGetTime();
+  uint64_t cpu_start = ClockGetTime();
+  result.seed = trial_seed(options.seed, trial);
+  mt19937_64 rng(result.seed);
+  result.strategy = options.rounding;
+  if (options.rounding == ROUNDING_PORTFOLIO)
+    result.strategy = (trial == 1) ? ROUNDING_LARGEST
+                    : (trial == 2) ? ROUNDING_FRACTIONAL : ROUNDING_RANDOM;
+  result.started = true;
+
+  log << endl << "---- TRIAL " << trial << " ----" << endl;
+
+  banner("RUNNING ROUND-OFF ALGORITHM", log);
+
+  const Incumbent* bound = (options.rounding == ROUNDING_PORTFOLIO) ? &incumbent : NULL;
+  result.abandoned = (round_solution(data, result.xopt, &result.z_relax, result.strategy,
+                                     rng, log, bound, warm_start,
+                                     (trial == 1) ? columns : NULL) != 0);
+  result.z_round = solution_objective(result.xopt);
+  result.time = (TimerGetTime() - start) / 1000000.0;
+  if (result.abandoned)
+    return;
+
+  banner("INTEGER SOLUTION PRODUCED BY ROUND-OFF ALGORITHM", log);
+  print_solution(result.xopt, log);
+    
+  log << "Rounded solution is at most " 
+      << fixed << setprecision(2) << 100.0 * (result.z_round - result.z_relax) / result.z_relax 
+      << "% more expensive than the optimal solution." << endl;
+
+  incumbent.update(result.z_round);
+  if ((options.gap >= 0.0) 
+      && (incumbent.value() - result.z_relax <= options.gap * result.z_relax)) {
+    log << "The best solution is within the gap; the remaining trials are skipped." << endl;
+    incumbent.set_done();
+  }
+
+  // the CPU time is that of the whole program, so it is only reported 
+  // when the trials run one at a time
+  if ((options.trial_threads == 1) && (options.batch_threads == 1))
+    log << "Total computation time: " << ((ClockGetTime() - cpu_start) / 1000000.0) << " seconds." << endl;
+}
+
+/* This function runs all rounding trials. With more than one trial
+   thread, every thread takes the next trial that has not been started
+   yet. GLPK keeps its environment per thread, and round_solution frees it
+   after each trial, so the trials do not share any GLPK state. The output
+   of a trial is collected and printed when it has finished. The trial 
+   threads count their TSP calls for the scope of the calling thread. */
+void run_trials(const ProblemData &data, vector<TrialResult> &results, ostream &out = cout,
+                const ColumnPool* warm_start = NULL, ColumnPool* columns = NULL) {
+  TrialResult skipped;
+  skipped.started = false;
+  results.assign(options.trials, skipped);
+  Incumbent incumbent;
+  if (options.trial_threads == 1) {
+    for (int trial = 1; trial <= options.trials && !incumbent.done(); trial++) {
+      tsp_start_generation();
+      run_trial(data, trial, incumbent, results[trial - 1], out, warm_start, columns);
+      tsp_report(out);
+      out << endl;
+    }
+    return;
+  }
+
+  atomic<int> next_trial(1);
+  mutex output_lock;
+  vector<thread> threads;
+  TspStatsScope* scope = tsp_stats.scope;
+  for (int k = 0; k < min(options.trial_threads, options.trials); k++)
+    threads.push_back(thread([&]() {
+      tsp_enter_scope(scope);
+      for (int trial = next_trial++; trial <= options.trials; trial = next_trial++) {
+        if (incumbent.done())
+          break;
+        ostringstream log;
+        run_trial(data, trial, incumbent, results[trial - 1], log, warm_start, columns);
+        lock_guard<mutex> guard(output_lock);
+        out << log.str() << endl;
+      }
+    }));
+  for (int k = 0; k < threads.size(); k++)
+    threads[k].join();
+}
+
+/* This function prints the time and outcome of every trial, and the best
+   rounded solution. */
+void report_trials(const vector<TrialResult> &results, ostream &out = cout) {
+  banner("SUMMARY OF ROUNDING TRIALS", out);
+  int best = -1;
+  for (int k = 0; k < results.size(); k++) {
+    const TrialResult &result = results[k];
+    out << "Trial " << setw(3) << k + 1 << ": ";
+    if (!result.started) {
+      out << "skipped" << endl;
+      continue;
+    }
+    out << strategy_name(result.strategy) << ", seed=" << result.seed;
+    if (result.abandoned)
+      out << ", abandoned";
+    else
+      out << ", z=" << fixed << setprecision(OBJ_OUTPUT_PRECISION) << result.z_round
+           << ", gap=" << setprecision(2) << 100.0 * (result.z_round - result.z_relax) / result.z_relax << "%";
+    out << ", time=" << fixed << setprecision(2) << result.time << " s" << endl;
+    if (!result.abandoned && ((best < 0) || (result.z_round < results[best].z_round)))
+      best = k;
+  }
+  if (best >= 0) {
+    out << endl << "Best solution found in trial " << best + 1 << ":" << endl;
+    print_solution(results[best].xopt, out);
+  }
+}
+
+/* Structure for storing the outcome of a scenario of a batch run */
+struct ScenarioResult {
+  string demand_file;         // file with the demands of the scenario
+  bool solved;                // false if the demands could not be read
+  int demand;                 // total demand
+  int trials;                 // number of trials that were run
+  double z_relax;             // objective value of the LP relaxation
+  double z_best;              // best rounded solution, or infinity if none
+  double time;                // wall clock time, in seconds
+};
+
+/* This function expands the demand files and patterns of a batch run with
+   glob(3). A pattern that matches no files is kept as it is, so that it is 
+   reported as a file that cannot be read. */
+void expand_demand_files(const vector<string> &patterns, vector<string> &files) {
+  for (int k = 0; k < patterns.size(); k++) {
+    glob_t matches;
+    if (glob(patterns[k].c_str(), GLOB_NOCHECK, NULL, &matches) == 0)
+      for (size_t i = 0; i < matches.gl_pathc; i++)
+        files.push_back(matches.gl_pathv[i]);
+    else
+      files.push_back(patterns[k]);
+    globfree(&matches);
+  }
+}
+
+/* This function solves one scenario of a batch run: the platforms in 
+   platforms with the demands in the scenario's demand file. The trials 
+   and their summary are written to log. The LP relaxation starts from 
+   warm_start if it is given, and its columns are stored in columns. The 
+   TSP statistics in log are those of this scenario only, also while other
+   scenarios are solved at the same time. */
+void run_scenario(const ProblemData &platforms, ScenarioResult &scenario, ostream &log,
+                  const ColumnPool* warm_start, ColumnPool &columns) {
+  uint64_t start = TimerGetTime();
+  TspStatsScope* outer = tsp_stats.scope;
+  TspStatsScope scope;
+  tsp_enter_scope(&scope);
+  banner("SCENARIO " + scenario.demand_file, log);
+
+  ProblemData data(platforms);
+  scenario.solved = read_demands(scenario.demand_file, data);
+  scenario.demand = 0;
+  scenario.trials = 0;
+  scenario.z_relax = 0.0;
+  scenario.z_best = numeric_limits<double>::infinity();
+  if (scenario.solved) {
+    for (int i = 1; i <= data.N; i++)
+      scenario.demand += data.D[i];
+
+    vector<TrialResult> results;
+    run_trials(data, results, log, warm_start, &columns);
+    report_trials(results, log);
+    for (int k = 0; k < results.size(); k++) {
+      if (!results[k].started)
+        continue;
+      scenario.trials++;
+      scenario.z_relax = results[k].z_relax;
+      if (!results[k].abandoned)
+        scenario.z_best = min(scenario.z_best, results[k].z_round);
+    }
+  }
+  tsp_enter_scope(outer);
+  scenario.time = (TimerGetTime() - start) / 1000000.0;
+}
+
+/* This function solves all scenarios of a batch run. The scenarios share
+   the distances, the TSP cache, the infeasible sets and the route catalog,
+   so that the tours calculated for one scenario are reused by the others.
+   With more than one batch thread, every thread takes the next scenario
+   that has not been started yet, and the output of a scenario is printed
+   when it has finished. Every scenario starts from the columns that are
+   given in columns, or with --warm-start, from the columns of the last
+   scenario that has finished; those are left in columns at the end. */
+void run_batch(const ProblemData &platforms, vector<ScenarioResult> &scenarios,
+               ColumnPool &columns) {
+  const ColumnPool initial(columns);
+  mutex columns_lock;
+  auto solve = [&](int k, ostream &log) {
+    ColumnPool warm_start, solved;
+    {
+      lock_guard<mutex> guard(columns_lock);
+      warm_start = options.warm_start ? columns : initial;
+    }
+    run_scenario(platforms, scenarios[k], log, warm_start.empty() ? NULL : &warm_start, solved);
+    if (!solved.empty()) {
+      lock_guard<mutex> guard(columns_lock);
+      columns = solved;
+    }
+  };
+
+  if (options.batch_threads == 1) {
+    for (int k = 0; k < scenarios.size(); k++) {
+      solve(k, cout);
+      cout << endl;
+    }
+    return;
+  }
+
+  atomic<int> next_scenario(0);
+  mutex output_lock;
+  vector<thread> threads;
+  int n = scenarios.size();
+  for (int k = 0; k < min(options.batch_threads, n); k++)
+    threads.push_back(thread([&]() {
+      for (int s = next_scenario++; s < n; s = next_scenario++) {
+        ostringstream log;
+        solve(s, log);
+        lock_guard<mutex> guard(output_lock);
+        cout << log.str() << endl;
+      }
+    }));
+  for (int k = 0; k < threads.size(); k++)
+    threads[k].join();
+}
+
+/* This function prints a table with a line per scenario of a batch run */
+void report_batch(const vector<ScenarioResult> &scenarios) {
+  banner("SUMMARY OF SCENARIOS");
+  size_t width = 8;
+  for (int k = 0; k < scenarios.size(); k++)
+    width = max(width, scenarios[k].demand_file.size() + 2);
+  cout << left << setw(width) << "Scenario" << right
+       << setw(8) << "Demand" << setw(12) << "LP bound" << setw(12) << "Best z"
+       << setw(9) << "Gap" << setw(8) << "Trials" << setw(10) << "Time (s)" << endl;
+  for (int k = 0; k < scenarios.size(); k++) {
+    const ScenarioResult &scenario = scenarios[k];
+    cout << left << setw(width) << scenario.demand_file << right;
+    if (!scenario.solved) {
+      cout << setw(8) << "-" << "  could not be read" << endl;
+      continue;
+    }
+    cout << setw(8) << scenario.demand << fixed << setprecision(OBJ_OUTPUT_PRECISION)
+         << setw(12) << scenario.z_relax;
+    if (scenario.z_best < numeric_limits<double>::infinity())
+      cout << setw(12) << scenario.z_best << setprecision(2) 
+           << setw(8) << 100.0 * (scenario.z_best - scenario.z_relax) / scenario.z_relax << "%";
+    else
+      cout << setw(12) << "-" << setw(9) << "-";
+    cout << setw(8) << scenario.trials << setprecision(2) << setw(10) << scenario.time << endl;
+  }
+}
+
 /* Main function */
 int main(int argc, char* argv[]) {
 
-  timeval time;
-  gettimeofday(&time, NULL);
-  srand((time.tv_sec * 1000) + (time.tv_usec / 1000));
-  
   // problem parameters
   int C = 23;
   int R = 200;
   int N = 51;
   
-  if (argc != 3) {
-    cerr << "Usage: helicopter <platform file> <demand file>" << endl;
+  vector<string> args;
+  if (!parse_options(argc, argv, options, args) || (args.size() < 2)
+      || (!options.batch && (args.size() != 2))) {
+    usage();
     return 1;
   }
-  string platform_file(argv[1]);
-  string demand_file(argv[2]);
+
+  // Without a given seed, the random numbers depend on the clock; the seed
+  // is printed, so that the run can be repeated
+  if (!options.has_seed) {
+    timeval time;
+    gettimeofday(&time, NULL);
+    options.seed = (time.tv_sec * 1000) + (time.tv_usec / 1000);
+  }
+  cout << "Random seed: " << options.seed << endl;
+  string platform_file(args[0]);
 
   ProblemData data;
 
-  // Read the input data
-  if (!read_data(platform_file, demand_file, data))
+  // Read the input data; in a batch run, the demands are read per scenario
+  vector<ScenarioResult> scenarios;
+  if (options.batch) {
+    vector<string> demand_files;
+    expand_demand_files(vector<string>(args.begin() + 1, args.end()), demand_files);
+    scenarios.resize(demand_files.size());
+    for (int k = 0; k < demand_files.size(); k++)
+      scenarios[k].demand_file = demand_files[k];
+
+    cout << "Reading platform data" << endl;
+    if (!read_platforms(platform_file, data))
+      return 1;
+    cout << "Succesfully read data for " << data.N << " platforms, " 
+         << scenarios.size() << " scenarios" << endl;
+  } else if (!read_data(platform_file, args[1], data))
     return 1;
 
+  // Size the sets of platforms
+  tsp_cache.set_key_words(dbitset::num_words(data.N + 1));
+  infeasible_sets.resize(data.N + 1);
+  route_catalog.resize(data.N + 1);
+  if (options.cache_memory > 0)
+    tsp_cache.set_max_bytes(options.cache_memory);
+  if (options.cache_entries > 0)
+    tsp_cache.set_max_entries(options.cache_entries);
+
   // Calculate distances between platforms
   calculate_distances(data);
-  
-  for (int trial = 1; trial <= 16; trial++) {
 
-    uint64_t start = ClockGetTime();
+  // Load the tours calculated by earlier runs on the same platforms
+  uint64_t fingerprint = tsp_fingerprint(data);
+  if (!options.cache_file.empty()) {
+    if (tsp_cache_file.open(options.cache_file, tsp_cache.key_words(), fingerprint))
+      cout << "Loaded " << tsp_cache_file.size() << " tours from " << options.cache_file << endl;
+    else
+      cout << "No usable TSP cache in " << options.cache_file << endl;
+  }
 
-    cout << endl << "---- TRIAL " << trial << " ----" << endl;
+  if (!options.cg_trace.empty()) {
+    cg_trace.open(options.cg_trace.c_str());
+    if (!cg_trace) {
+      cerr << "Could not open " << options.cg_trace << endl;
+      return 1;
+    }
+    cg_trace << "solve,iteration,objective,alpha,mispricings,columns,"
+             << "dual_step,center_distance,reduced_cost,lower_bound" << endl;
+  }
 
-    banner("RUNNING ROUND-OFF ALGORITHM");
+  // Load the columns generated by an earlier run on the same platforms
+  ColumnPool columns;
+  if (!options.load_columns.empty()) {
+    if (columns.load(options.load_columns, fingerprint))
+      cout << "Loaded " << columns.columns.size() << " columns from " << options.load_columns << endl;
+    else
+      cout << "No usable columns in " << options.load_columns << endl;
+  }
+  
+  if (options.batch) {
+    run_batch(data, scenarios, columns);
+    report_batch(scenarios);
+  } else {
+    ColumnPool warm_start(columns);
+    vector<TrialResult> results;
+    run_trials(data, results, cout, warm_start.empty() ? NULL : &warm_start, &columns);
+    report_trials(results);
+  }
+         
+  tsp_report(cout, &tsp_stats_all);
 
-    vector<Flight> xopt;
-    double z_relax;
-    round_solution(data, xopt, &z_relax);
-    double z_round = solution_objective(xopt);
+  if (!options.cache_file.empty()) {
+    long saved = tsp_cache_file.save(options.cache_file, fingerprint, tsp_cache);
+    if (saved < 0)
+      cerr << "Could not write TSP cache to " << options.cache_file << endl;
+    else
+      cout << "Saved " << saved << " tours to " << options.cache_file << endl;
+  }
 
-    banner("INTEGER SOLUTION PRODUCED BY ROUND-OFF ALGORITHM");
-    print_solution(xopt, cout);
-    
-    cout << "Rounded solution is at most " 
-         << fixed << setprecision(2) << 100.0 * (z_round - z_relax) / z_relax 
-         << "% more expensive than the optimal solution." << endl;
-         
-    cout << "Total computation time: " << ((ClockGetTime() - start) / 1000000.0) << " seconds." << endl;
-    cout << endl;
+  if (!options.save_columns.empty()) {
+    if (!columns.save(options.save_columns, fingerprint))
+      cerr << "Could not write columns to " << options.save_columns << endl;
+    else
+      cout << "Saved " << columns.columns.size() << " columns to " << options.save_columns << endl;
   }
-         
-  tsp_report();
+
+  // a batch run fails if any of its demand files could not be read
+  for (int k = 0; k < scenarios.size(); k++)
+    if (!scenarios[k].solved)
+      return 1;
 }
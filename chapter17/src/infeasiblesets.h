@@ -0,0 +1,286 @@
+/*
+ * Index of minimal infeasible platform sets
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides an index of sets of platforms that cannot be
+   visited in a single flight. Since a tour through a set is never shorter
+   than a tour through one of its subsets, every superset of such a set is
+   infeasible as well, and only the minimal ones (an antichain) are kept.
+   The sets are stored as the 64-bit words of their dbitsets, and every set
+   is listed under each of its platforms.
+   InfeasibleSetWalk uses the index during the depth-first subset walk in
+   the pricing loop. For the current prefix of the walk, it keeps the 
+   platforms that would complete one of the sets in the index. Appending a
+   platform p to the prefix only requires a scan of the sets containing p,
+   with word-parallel bit operations, and after that, the sets that extend 
+   the prefix by one platform are checked with a single bit test. */
+
+#ifndef INFEASIBLESETS__
+#define INFEASIBLESETS__
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "dbitset.h"
+
+class InfeasibleSetIndex {
+public:
+  // constructor initializes an empty index for sets of platforms 0, ..., 
+  // nbits - 1
+  explicit InfeasibleSetIndex(size_t nbits = 0) : size_(0) {
+    resize(nbits);
+  }
+
+  // Empty the index, and prepare it for sets of platforms 0, ..., nbits - 1.
+  void resize(size_t nbits) {
+    std::unique_lock<std::shared_timed_mutex> guard(lock_);
+    key_words_ = dbitset::num_words(nbits);
+    lists_.assign(nbits, std::vector<uint64_t>());
+    singletons_.assign(key_words_, 0);
+    size_ = 0;
+  }
+
+  // number of 64-bit words per set
+  size_t key_words() const {
+    return key_words_;
+  }
+
+  // Check whether the index holds a subset of bs.
+  bool contains_subset_of(const dbitset& bs) const {
+    assert(bs.num_words() == key_words_);
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return find_subset(bs.words());
+  }
+
+  // Add an infeasible set, unless one of its subsets is in the index
+  // already. The supersets of bs are removed. Returns whether bs was added.
+  bool insert(const dbitset& bs) {
+    assert(bs.num_words() == key_words_);
+    const uint64_t* key = bs.words();
+    std::unique_lock<std::shared_timed_mutex> guard(lock_);
+    if (find_subset(key))
+      return false;
+
+    // the supersets of bs are all listed under each platform of bs
+    int first = -1, count = 0;
+    for (size_t k = 0; k < key_words_; k++) {
+      if ((first < 0) && (key[k] != 0))
+        first = 64 * k + __builtin_ctzll(key[k]);
+      count += __builtin_popcountll(key[k]);
+    }
+    if (first < 0)
+      return false;              // the empty set is always feasible
+    std::vector<uint64_t>& list = lists_[first];
+    for (size_t i = 0; i < list.size(); ) {
+      if (is_subset(key, &list[i])) {
+        std::vector<uint64_t> superset(&list[i], &list[i] + key_words_);
+        remove(&superset[0]);
+      } else
+        i += key_words_;
+    }
+
+    for (size_t k = 0; k < key_words_; k++)
+      for (uint64_t w = key[k]; w != 0; w &= w - 1) {
+        std::vector<uint64_t>& list = lists_[64 * k + __builtin_ctzll(w)];
+        list.insert(list.end(), key, key + key_words_);
+      }
+    if (count == 1)
+      for (size_t k = 0; k < key_words_; k++)
+        singletons_[k] |= key[k];
+    size_++;
+    return true;
+  }
+
+  // Add to blocked the platforms that are infeasible on their own.
+  void add_singletons(uint64_t* blocked) const {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    for (size_t k = 0; k < key_words_; k++)
+      blocked[k] |= singletons_[k];
+  }
+
+  // Add to blocked every platform e outside the set key for which key and
+  // e together contain a set in the index that contains platform p.
+  void add_blocked(const uint64_t* key, int p, uint64_t* blocked) const {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    const std::vector<uint64_t>& list = lists_[p];
+    if (key_words_ == 1) {
+      // branch-free, so that the compiler can vectorize it
+      uint64_t notkey = ~key[0];
+      uint64_t b = 0;
+      for (size_t i = 0; i < list.size(); i++) {
+        uint64_t rest = list[i] & notkey;
+        b |= ((rest & (rest - 1)) == 0) ? rest : 0;
+      }
+      blocked[0] |= b;
+      return;
+    }
+    for (size_t i = 0; i < list.size(); i += key_words_) {
+      int count = 0;
+      for (size_t k = 0; k < key_words_; k++)
+        count += __builtin_popcountll(list[i + k] & ~key[k]);
+      if (count == 1)
+        for (size_t k = 0; k < key_words_; k++)
+          blocked[k] |= list[i + k] & ~key[k];
+    }
+  }
+
+  // number of sets in the index
+  size_t size() const {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return size_;
+  }
+
+  void clear() {
+    std::unique_lock<std::shared_timed_mutex> guard(lock_);
+    for (size_t e = 0; e < lists_.size(); e++)
+      lists_[e].clear();
+    for (size_t k = 0; k < key_words_; k++)
+      singletons_[k] = 0;
+    size_ = 0;
+  }
+
+private:
+  mutable std::shared_timed_mutex lock_;
+  size_t key_words_;                             // number of 64-bit words per set
+  std::vector<std::vector<uint64_t> > lists_;    // the sets that contain each platform
+  std::vector<uint64_t> singletons_;  // the platforms that are sets on their own
+  size_t size_;
+
+  inline bool is_subset(const uint64_t* a, const uint64_t* b) const {
+    for (size_t k = 0; k < key_words_; k++)
+      if ((a[k] & ~b[k]) != 0)
+        return false;
+    return true;
+  }
+
+  // check whether the index holds a subset of key
+  bool find_subset(const uint64_t* key) const {
+    for (size_t k = 0; k < key_words_; k++)
+      for (uint64_t w = key[k]; w != 0; w &= w - 1) {
+        const std::vector<uint64_t>& list = lists_[64 * k + __builtin_ctzll(w)];
+        for (size_t i = 0; i < list.size(); i += key_words_)
+          if (is_subset(&list[i], key))
+            return true;
+      }
+    return false;
+  }
+
+  // remove the set key from the lists of its platforms
+  void remove(const uint64_t* key) {
+    for (size_t k = 0; k < key_words_; k++)
+      for (uint64_t w = key[k]; w != 0; w &= w - 1) {
+        std::vector<uint64_t>& list = lists_[64 * k + __builtin_ctzll(w)];
+        for (size_t i = 0; i < list.size(); i += key_words_) {
+          bool equal = true;
+          for (size_t j = 0; j < key_words_; j++)
+            equal = equal && (list[i + j] == key[j]);
+          if (equal) {
+            for (size_t j = 0; j < key_words_; j++)
+              list[i + j] = list[list.size() - key_words_ + j];
+            list.resize(list.size() - key_words_);
+            break;
+          }
+        }
+      }
+    size_--;
+  }
+};
+
+/* This class follows the depth-first subset walk in the same way as 
+   TspLattice: the walk reaches every set by appending one platform to a 
+   set that it has just found to be feasible. Level k holds the first k 
+   platforms of the current set as a key, together with the platforms that 
+   would complete a set in the index when appended to them. The levels are
+   filled in lazily. Sets that are added to the index after a level was
+   filled in are only taken into account after the walk backtracks past
+   that level; level 0 (the single infeasible platforms) is filled in once. */
+class InfeasibleSetWalk {
+public:
+  explicit InfeasibleSetWalk(const InfeasibleSetIndex& index)
+    : index_(&index), key_words_(index.key_words()), computed_(0), 
+      levels_(2 * key_words_) { }
+
+  // number of platforms in the current set
+  int size() const { return S_.size(); }
+
+  // keep only the first k platforms of the current set
+  void truncate(int k) {
+    if (k < S_.size())
+      S_.resize(k);
+    if (computed_ > k + 1)
+      computed_ = k + 1;
+  }
+
+  // append a platform to the current set
+  void push(int platform) {
+    S_.push_back(platform);
+  }
+
+  // Check whether the current set contains a set in the index. Only the
+  // sets containing the last platform are considered, as the set without 
+  // it is known to be feasible.
+  bool contains_infeasible_set() {
+    int n = S_.size();
+    assert(n > 0);
+    while (computed_ < n)
+      compute_level(computed_++);
+    int e = S_[n - 1];
+    return (blocked(n - 1)[e / 64] >> (e % 64)) & 1;
+  }
+
+private:
+  const InfeasibleSetIndex* index_;
+  size_t key_words_;             // number of 64-bit words per set
+  std::vector<int> S_;           // platforms in the order they were appended
+  int computed_;                 // number of valid levels
+  std::vector<uint64_t> levels_; // key and blocked platforms of each level
+
+  uint64_t* key(int k) { return &levels_[2 * key_words_ * k]; }
+  uint64_t* blocked(int k) { return &levels_[2 * key_words_ * k + key_words_]; }
+
+  // fill in level k from level k - 1
+  void compute_level(int k) {
+    if (levels_.size() < 2 * key_words_ * (k + 1))
+      levels_.resize(2 * key_words_ * (k + 1));
+    if (k == 0) {
+      for (unsigned int j = 0; j < 2 * key_words_; j++)
+        levels_[j] = 0;
+      index_->add_singletons(blocked(0));
+      return;
+    }
+    int p = S_[k - 1];
+    for (size_t j = 0; j < key_words_; j++) {
+      key(k)[j] = key(k - 1)[j];
+      blocked(k)[j] = blocked(k - 1)[j];
+    }
+    key(k)[p / 64] |= static_cast<uint64_t>(1) << (p % 64);
+    index_->add_blocked(key(k), p, blocked(k));
+  }
+};
+
+#endif
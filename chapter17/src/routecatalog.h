@@ -0,0 +1,237 @@
+/*
+ * Catalog of feasible routes
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a catalog of routes: sets of platforms that
+   can be visited in a single flight, together with the length of their
+   shortest tour. The routes are stored in structure-of-arrays layout:
+   slot j of the catalog holds the j-th platform of every route, where
+   shorter routes are padded with platform 0 (the airport). Given the dual
+   values y and the demands D, the reduced costs of all routes are then
+   calculated with loops over the routes that the compiler vectorizes, and
+   only routes whose demands exceed the capacity need a scalar pass. */
+
+#ifndef ROUTECATALOG__
+#define ROUTECATALOG__
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "dbitset.h"
+#include "tspcache.h"
+
+class RouteCatalog {
+public:
+  // a route with its reduced cost, see price()
+  struct Candidate {
+    size_t route;
+    double reduced_cost;
+  };
+
+  // constructor initializes an empty catalog for routes through platforms
+  // 1, ..., nbits - 1
+  explicit RouteCatalog(size_t nbits = 1) {
+    resize(nbits);
+  }
+
+  // Empty the catalog, and prepare it for routes through platforms 1, ...,
+  // nbits - 1.
+  void resize(size_t nbits) {
+    assert(nbits <= 65536);
+    std::unique_lock<std::shared_timed_mutex> guard(lock_);
+    nbits_ = nbits;
+    length_.clear();
+    slots_.clear();
+    index_ = TspCache(dbitset::num_words(nbits));
+  }
+
+  // Add a route with the given platforms and tour length, unless it is in
+  // the catalog already. Returns whether the route was added.
+  bool insert(const std::vector<int>& S, double length) {
+    dbitset bs(nbits_);
+    for (size_t j = 0; j < S.size(); j++)
+      bs.set(S[j]);
+    return insert(S, bs, length);
+  }
+
+  // Same as above, for a route whose platforms are also given as bitset bs
+  bool insert(const std::vector<int>& S, const dbitset& bs, double length) {
+    assert(bs.num_words() == dbitset::num_words(nbits_));
+    size_t h = TspCache::hash(bs);
+
+    std::unique_lock<std::shared_timed_mutex> guard(lock_);
+    double route;
+    if (index_.find(bs, h, &route))
+      return false;
+    index_.insert(bs, h, length_.size());
+
+    size_t r = length_.size();
+    length_.push_back(length);
+    while (slots_.size() < S.size())
+      slots_.push_back(std::vector<uint16_t>(r, 0));
+    for (size_t j = 0; j < slots_.size(); j++)
+      slots_[j].push_back((j < S.size()) ? S[j] : 0);
+    return true;
+  }
+
+  // Find the at most k routes with the most negative reduced cost below
+  // -tolerance, for dual values y and demands D (indexed by platform, with
+  // y[0] = D[0] = 0) and capacity C. The capacity of a route is given to
+  // its platforms in order of decreasing dual value, as in the pricing
+  // walk. Routes that visit a platform without demand are skipped. The
+  // candidates are returned in order of increasing reduced cost.
+  void price(const std::vector<double>& y, const std::vector<int>& D, int C,
+             size_t k, double tolerance, std::vector<Candidate>& best) const {
+    best.clear();
+    if (k == 0)
+      return;
+
+    // per platform: D[i] y[i], and D[i], or a demand that exceeds any
+    // capacity for platforms without demand, so that they are skipped
+    size_t n = std::max(y.size(), D.size());
+    std::vector<double> Dy(n, 0.0);
+    std::vector<int> demand(n, 0);
+    int skip = C + 1;
+    for (size_t i = 1; i < n; i++) {
+      Dy[i] = D[i] * y[i];
+      demand[i] = (D[i] > 0) ? D[i] : -skip;
+    }
+
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    double value[BLOCK];
+    int total[BLOCK];
+    int missing[BLOCK];
+    std::vector<int> S;
+    for (size_t start = 0; start < length_.size(); start += BLOCK) {
+      size_t m = std::min(static_cast<size_t>(BLOCK), length_.size() - start);
+      for (size_t r = 0; r < m; r++) {
+        value[r] = 0.0;
+        total[r] = 0;
+        missing[r] = 0;
+      }
+      for (size_t j = 0; j < slots_.size(); j++) {
+        const uint16_t* slot = &slots_[j][start];
+        for (size_t r = 0; r < m; r++) {
+          value[r] += Dy[slot[r]];
+          total[r] += demand[slot[r]];
+          missing[r] |= demand[slot[r]];
+        }
+      }
+
+      for (size_t r = 0; r < m; r++) {
+        if (missing[r] < 0)
+          continue;            // visits a platform without demand
+        double c = length_[start + r] - value[r];
+        if (total[r] > C) {
+          // only part of the demand fits; a scalar pass gives the capacity
+          // to the platforms with the highest dual values
+          if (length_[start + r] - C * max_dual(start + r, y) >= -tolerance)
+            continue;
+          c = reduced_cost(start + r, y, D, C, S);
+        }
+        if ((c < -tolerance)
+            && ((best.size() < k) || (c < best.back().reduced_cost))) {
+          Candidate candidate = { start + r, c };
+          if (best.size() == k)
+            best.pop_back();
+          best.insert(std::upper_bound(best.begin(), best.end(), candidate, by_reduced_cost), candidate);
+        }
+      }
+    }
+  }
+
+  // the platforms of route r
+  void route(size_t r, std::vector<int>& S) const {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    S.clear();
+    for (size_t j = 0; (j < slots_.size()) && (slots_[j][r] != 0); j++)
+      S.push_back(slots_[j][r]);
+  }
+
+  // tour length of route r
+  double length(size_t r) const {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return length_[r];
+  }
+
+  // number of routes in the catalog
+  size_t size() const {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return length_.size();
+  }
+
+  size_t memory_usage() const {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return length_.capacity() * (sizeof(double) + slots_.size() * sizeof(uint16_t)) 
+      + index_.memory_usage();
+  }
+
+private:
+  // number of routes handled at a time by price()
+  enum { BLOCK = 1024 };
+
+  mutable std::shared_timed_mutex lock_;
+  size_t nbits_;                               // number of platforms + 1
+  std::vector<double> length_;                 // tour length of each route
+  std::vector<std::vector<uint16_t> > slots_;  // platform j of each route
+  TspCache index_;                             // route number of each set
+
+  static bool by_reduced_cost(const Candidate& a, const Candidate& b) {
+    return a.reduced_cost < b.reduced_cost;
+  }
+
+  // highest dual value of the platforms of route r
+  double max_dual(size_t r, const std::vector<double>& y) const {
+    double z = 0.0;
+    for (size_t j = 0; (j < slots_.size()) && (slots_[j][r] != 0); j++)
+      z = std::max(z, y[slots_[j][r]]);
+    return z;
+  }
+
+  // reduced cost of route r with the capacity split in order of
+  // decreasing dual value; S is used as scratch space
+  double reduced_cost(size_t r, const std::vector<double>& y,
+                      const std::vector<int>& D, int C,
+                      std::vector<int>& S) const {
+    S.clear();
+    for (size_t j = 0; (j < slots_.size()) && (slots_[j][r] != 0); j++)
+      S.push_back(slots_[j][r]);
+    std::sort(S.begin(), S.end(), [&y](int a, int b) { return y[a] > y[b]; });
+    double c = length_[r];
+    int Cremaining = C;
+    for (size_t j = 0; j < S.size(); j++) {
+      int w = std::min(Cremaining, D[S[j]]);
+      Cremaining -= w;
+      c -= w * y[S[j]];
+    }
+    return c;
+  }
+};
+
+#endif
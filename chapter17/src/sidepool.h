@@ -0,0 +1,195 @@
+/*
+ * Side pool of columns
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a pool of columns that have been taken out of
+   the LP model, because they were nonbasic with a positive reduced cost
+   for a long time, or because they carried more crew to a platform than
+   its remaining demand. Only the route of a column is kept: its platforms,
+   stored one after the other in a single array, and its length. When the
+   pool is priced, the capacity of a route is given to its platforms in 
+   order of decreasing dual value, as in the pricing walk, so that a route
+   gives the best column for the current demands and dual values. Routes
+   that are taken back into the model are erased from the pool. */
+
+#ifndef SIDEPOOL__
+#define SIDEPOOL__
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+#include "dbitset.h"
+
+class SidePool {
+public:
+  // a route with its reduced cost, see price()
+  struct Candidate {
+    size_t route;
+    double reduced_cost;
+  };
+
+  // constructor initializes an empty pool for routes through platforms 
+  // 1, ..., nbits - 1
+  explicit SidePool(size_t nbits = 1) : nbits_(nbits), start_(1, 0) { 
+    assert(nbits <= 65536);
+  }
+
+  // Add a route with the given platforms and length, unless it is in the
+  // pool already. Returns whether the route was added.
+  bool insert(const std::vector<int>& S, double length) {
+    dbitset bs(nbits_);
+    for (size_t j = 0; j < S.size(); j++)
+      bs.set(S[j]);
+    if (!members_.insert(bs).second)
+      return false;
+    for (size_t j = 0; j < S.size(); j++)
+      platforms_.push_back(S[j]);
+    start_.push_back(platforms_.size());
+    length_.push_back(length);
+    return true;
+  }
+
+  // Find the at most k routes with the most negative reduced cost below
+  // -tolerance, for dual values y and demands D (indexed by platform) and
+  // capacity C. Routes that visit a platform without demand are skipped. 
+  // The candidates are returned in order of increasing reduced cost.
+  void price(const std::vector<double>& y, const std::vector<int>& D, int C,
+             size_t k, double tolerance, std::vector<Candidate>& best) const {
+    best.clear();
+    std::vector<int> S;
+    for (size_t r = 0; (k > 0) && (r < length_.size()); r++) {
+      double value = 0.0;
+      int total = 0;
+      bool served = true;
+      for (uint32_t j = start_[r]; j < start_[r+1]; j++) {
+        int i = platforms_[j];
+        value += D[i] * y[i];
+        total += D[i];
+        served = served && (D[i] > 0);
+      }
+      if (!served)
+        continue;
+      double c = length_[r] - value;
+      if (total > C)
+        c = reduced_cost(r, y, D, C, S);
+      if ((c < -tolerance)
+          && ((best.size() < k) || (c < best.back().reduced_cost))) {
+        Candidate candidate = { r, c };
+        if (best.size() == k)
+          best.pop_back();
+        best.insert(std::upper_bound(best.begin(), best.end(), candidate, by_reduced_cost), candidate);
+      }
+    }
+  }
+
+  // the platforms of route r
+  void route(size_t r, std::vector<int>& S) const {
+    S.assign(platforms_.begin() + start_[r], platforms_.begin() + start_[r+1]);
+  }
+
+  // length of route r
+  double length(size_t r) const {
+    return length_[r];
+  }
+
+  // Erase the given routes; the other routes are renumbered.
+  void erase(const std::vector<size_t>& routes) {
+    std::vector<bool> keep(length_.size(), true);
+    for (size_t k = 0; k < routes.size(); k++)
+      keep[routes[k]] = false;
+    compact(keep);
+  }
+
+  // Erase the routes that visit a platform without demand.
+  void erase_unserved(const std::vector<int>& D) {
+    std::vector<bool> keep(length_.size(), true);
+    for (size_t r = 0; r < length_.size(); r++)
+      for (uint32_t j = start_[r]; j < start_[r+1]; j++)
+        if (D[platforms_[j]] <= 0)
+          keep[r] = false;
+    compact(keep);
+  }
+
+  // number of routes in the pool
+  size_t size() const {
+    return length_.size();
+  }
+
+private:
+  size_t nbits_;                         // number of platforms + 1
+  std::vector<uint16_t> platforms_;      // platforms of all routes
+  std::vector<uint32_t> start_;          // route r is platforms_[start_[r]..start_[r+1])
+  std::vector<double> length_;           // length of each route
+  std::unordered_set<dbitset> members_;  // platforms of each route as a set
+
+  static bool by_reduced_cost(const Candidate& a, const Candidate& b) {
+    return a.reduced_cost < b.reduced_cost;
+  }
+
+  // reduced cost of route r with the capacity split in order of
+  // decreasing dual value; S is used as scratch space
+  double reduced_cost(size_t r, const std::vector<double>& y,
+                      const std::vector<int>& D, int C,
+                      std::vector<int>& S) const {
+    route(r, S);
+    std::sort(S.begin(), S.end(), [&y](int a, int b) { return y[a] > y[b]; });
+    double c = length_[r];
+    int Cremaining = C;
+    for (size_t j = 0; j < S.size(); j++) {
+      int w = std::min(Cremaining, D[S[j]]);
+      Cremaining -= w;
+      c -= w * y[S[j]];
+    }
+    return c;
+  }
+
+  // keep only the routes r with keep[r], in the same order
+  void compact(const std::vector<bool>& keep) {
+    size_t n = 0, m = 0;
+    for (size_t r = 0; r < length_.size(); r++) {
+      if (!keep[r]) {
+        dbitset bs(nbits_);
+        for (uint32_t j = start_[r]; j < start_[r+1]; j++)
+          bs.set(platforms_[j]);
+        members_.erase(bs);
+        continue;
+      }
+      uint32_t begin = start_[r], end = start_[r+1];
+      start_[n] = m;
+      for (uint32_t j = begin; j < end; j++)
+        platforms_[m++] = platforms_[j];
+      length_[n++] = length_[r];
+    }
+    start_[n] = m;
+    start_.resize(n + 1);
+    platforms_.resize(m);
+    length_.resize(n);
+  }
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * Compile-time tour tables
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides tables of all tours from node 0 through nodes
+   1, ..., K and back, which are generated at compile time. They are used
+   to calculate the TSP tours through small sets of platforms without any
+   branching. On x86 processors with AVX-512, blocks of 8 tours are 
+   evaluated at once with gathers from the distance matrix; whether the 
+   processor supports it is checked at runtime. AVX2 gathers of 4 tours are
+   slower than the scalar loop, so there is no AVX2 kernel. */
+
+#ifndef TOURTABLE__
+#define TOURTABLE__
+
+#include <limits.h>
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TOURTABLE_X86
+#include <immintrin.h>
+#endif
+
+/* Number of tours through K nodes, counting a tour and its reverse once */
+template <int K>
+struct tour_count {
+  enum { value = K * tour_count<K - 1>::value };
+};
+
+template <>
+struct tour_count<2> {
+  enum { value = 1 };
+};
+
+template <>
+struct tour_count<1> {
+  enum { value = 1 };
+};
+
+/* Table of the tours through K nodes. The distances are expected in a
+   (K+1)x(K+1) row-major matrix with node 0 in row 0. The table stores
+   tour r as the K+1 offsets edge[0][r], ..., edge[K][r] into that matrix of
+   the edges it uses, in the order in which they are flown. The number of
+   columns is padded to a multiple of 16 by repeating the first tour, so 
+   that vector kernels can work on whole blocks. The offsets are stored in
+   bytes, which limits K to 15. */
+template <int K>
+struct TourTable {
+  enum { size = tour_count<K>::value, 
+         padded_size = (tour_count<K>::value + 15) / 16 * 16 };
+  static_assert((K + 1) * (K + 1) - 1 <= UCHAR_MAX,
+                "the offsets of the edges of a tour table must fit in a byte");
+  unsigned char edge[K + 1][padded_size];
+};
+
+/* constexpr version of std::next_permutation */
+constexpr bool _tourtable_next_permutation(int* p, int n) {
+  int i = n - 2;
+  while ((i >= 0) && (p[i] >= p[i + 1]))
+    i--;
+  if (i < 0)
+    return false;
+  int j = n - 1;
+  while (p[j] <= p[i])
+    j--;
+  int t = p[i]; p[i] = p[j]; p[j] = t;
+  for (int a = i + 1, b = n - 1; a < b; a++, b--) {
+    t = p[a]; p[a] = p[b]; p[b] = t;
+  }
+  return true;
+}
+
+/* This function generates the table of tours through K nodes. Since a tour
+   and its reverse have the same length, only the permutations p with
+   p[0] < p[K-1] are included. */
+template <int K>
+constexpr TourTable<K> make_tour_table() {
+  TourTable<K> table = {};
+  int p[K] = {};
+  for (int i = 0; i < K; i++)
+    p[i] = i + 1;
+
+  int r = 0;
+  do {
+    if ((K == 1) || (p[0] < p[K - 1])) {
+      table.edge[0][r] = p[0];
+      for (int i = 1; i < K; i++)
+        table.edge[i][r] = p[i - 1] * (K + 1) + p[i];
+      table.edge[K][r] = p[K - 1] * (K + 1);
+      r++;
+    }
+  } while (_tourtable_next_permutation(p, K));
+
+  for (; r < TourTable<K>::padded_size; r++)
+    for (int i = 0; i <= K; i++)
+      table.edge[i][r] = table.edge[i][0];
+  return table;
+}
+
+/* Instruction sets for which vector kernels are available */
+enum tourtable_isa { TOURTABLE_SCALAR, TOURTABLE_AVX512 };
+
+/* This function returns the best instruction set supported by the 
+   processor we are running on. */
+inline tourtable_isa tourtable_detect_isa() {
+#ifdef TOURTABLE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return TOURTABLE_AVX512;
+#endif
+  return TOURTABLE_SCALAR;
+}
+
+/* This class holds the tour table for K nodes as a compile-time constant,
+   and finds the shortest of its tours for a given distance matrix. All 
+   kernels add up the edges of a tour in the order in which they are flown,
+   so they return exactly the same value. */
+template <int K>
+struct TourKernel {
+  static constexpr TourTable<K> table = make_tour_table<K>();
+
+  // length of the shortest tour for the (K+1)x(K+1) distance matrix dist,
+  // using the best kernel for this processor
+  static double shortest(const double* dist) {
+    static const tourtable_isa isa = tourtable_detect_isa();
+    // too few tours to fill the vectors
+    if (TourTable<K>::size < 16)
+      return shortest_scalar(dist);
+#ifdef TOURTABLE_X86
+    if (isa == TOURTABLE_AVX512)
+      return shortest_avx512(dist);
+#endif
+    return shortest_scalar(dist);
+  }
+
+  static double shortest_scalar(const double* dist) {
+    double z = 1e100;
+    for (int r = 0; r < TourTable<K>::size; r++) {
+      double length = dist[table.edge[0][r]];
+      for (int i = 1; i <= K; i++)
+        length += dist[table.edge[i][r]];
+      if (length < z)
+        z = length;
+    }
+    return z;
+  }
+
+#ifdef TOURTABLE_X86
+  // 16 tours at a time, in two independent blocks of 8
+  __attribute__((target("avx512f")))
+  static double shortest_avx512(const double* dist) {
+    __m512d z = _mm512_set1_pd(1e100);
+    for (int r = 0; r < TourTable<K>::padded_size; r += 16) {
+      __m512d a = _mm512_i32gather_pd(edges8(0, r), dist, 8);
+      __m512d b = _mm512_i32gather_pd(edges8(0, r + 8), dist, 8);
+      for (int i = 1; i <= K; i++) {
+        a = _mm512_add_pd(a, _mm512_i32gather_pd(edges8(i, r), dist, 8));
+        b = _mm512_add_pd(b, _mm512_i32gather_pd(edges8(i, r + 8), dist, 8));
+      }
+      z = _mm512_min_pd(z, _mm512_min_pd(a, b));
+    }
+    return _mm512_reduce_min_pd(z);
+  }
+
+  // offsets of edge i of tours r, ..., r+7
+  __attribute__((target("avx512f")))
+  static inline __m256i edges8(int i, int r) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+      reinterpret_cast<const __m128i*>(&table.edge[i][r])));
+  }
+#endif
+};
+
+template <int K>
+constexpr TourTable<K> TourKernel<K>::table;
+
+#endif
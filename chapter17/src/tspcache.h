@@ -0,0 +1,456 @@
+/*
+ * Open-addressing TSP cache
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a hash table that maps sets of platforms to
+   TSP tour lengths. It uses open addressing with linear probing, and
+   stores the keys and values in two contiguous arrays. A key is stored as
+   the 64-bit words of its dbitset, and all keys in a table have the same
+   number of words; sets of at most 64 platforms take a single word, for 
+   which lookups take a path without any loops. 
+   ShardedTspCache splits such a table into independently locked shards,
+   so that it can be shared by several threads. 
+   The number of sets in a table can be limited. When the limit is reached,
+   sets are evicted with the CLOCK policy: every set has a small counter,
+   which is raised when the set is looked up and lowered when the clock
+   hand passes it, and the hand evicts the first set whose counter is 0.
+   Sets can be inserted with a higher initial count, so that they survive
+   longer. */
+
+#ifndef TSPCACHE__
+#define TSPCACHE__
+
+#include <assert.h>
+#include <inttypes.h>
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "dbitset.h"
+
+class TspCache {
+public:
+  // the table is grown when it is more than this fraction full
+  static constexpr double max_load_factor = 0.5;
+
+  // largest value of the CLOCK counter of a set
+  enum { max_weight = 3 };
+
+  // constructor initializes an empty table for keys of the given number
+  // of 64-bit words
+  explicit TspCache(size_t key_words = 1)
+    : key_words_(key_words), size_(0), has_empty_(false), empty_value_(0.0),
+      max_entries_(0), hand_(0), evictions_(0) {
+    rehash(1024);
+  }
+
+  // number of 64-bit words per key
+  size_t key_words() const {
+    return key_words_;
+  }
+
+  // Look up a set. Returns true and stores its value in *value if the set
+  // is in the table.
+  bool find(const dbitset& bs, double* value) {
+    return find(bs, hash(bs), value);
+  }
+
+  // Same as above, for a set whose hash value h is known
+  bool find(const dbitset& bs, size_t h, double* value) {
+    assert(bs.num_words() == key_words_);
+    const uint64_t* key = bs.words();
+    if (key_words_ == 1) {
+      // sets of at most 64 platforms
+      if (key[0] == 0) {
+        if (has_empty_)
+          *value = empty_value_;
+        return has_empty_;
+      }
+      for (size_t i = h & mask_; ; i = (i + 1) & mask_) {
+        if (keys_[i] == key[0]) {
+          *value = values_[i];
+          if (weights_[i] < max_weight)
+            weights_[i]++;
+          return true;
+        }
+        if (keys_[i] == 0)
+          return false;
+      }
+    }
+    if (is_empty(key)) {
+      if (has_empty_)
+        *value = empty_value_;
+      return has_empty_;
+    }
+    for (size_t i = h & mask_; ; i = (i + 1) & mask_) {
+      const uint64_t* slot = &keys_[i * key_words_];
+      if (equal(slot, key)) {
+        *value = values_[i];
+        if (weights_[i] < max_weight)
+          weights_[i]++;
+        return true;
+      }
+      if (is_empty(slot))
+        return false;
+    }
+  }
+
+  // Store the value of a set, replacing any previous value. The weight
+  // is the initial value of the set's CLOCK counter (at most max_weight).
+  void insert(const dbitset& bs, double value, int weight = 1) {
+    insert(bs, hash(bs), value, weight);
+  }
+
+  // Same as above, for a set whose hash value h is known
+  void insert(const dbitset& bs, size_t h, double value, int weight = 1) {
+    assert(bs.num_words() == key_words_);
+    insert_key(bs.words(), h, value, weight);
+  }
+
+  // Same as above, for a set given by its key words
+  void insert_key(const uint64_t* key, size_t h, double value, int weight = 1) {
+    if (is_empty(key)) {
+      has_empty_ = true;
+      empty_value_ = value;
+      return;
+    }
+    if (size_ + 1 > max_load_factor * bucket_count())
+      rehash(2 * bucket_count());
+    size_t i = h & mask_;
+    for (; ; i = (i + 1) & mask_) {
+      uint64_t* slot = &keys_[i * key_words_];
+      if (equal(slot, key))
+        break;
+      if (is_empty(slot)) {
+        if ((max_entries_ > 0) && (size_ >= max_entries_)) {
+          // make room first; this may move sets around, so start over
+          evict();
+          insert_key(key, h, value, weight);
+          return;
+        }
+        memcpy(slot, key, key_words_ * sizeof(uint64_t));
+        size_++;
+        break;
+      }
+    }
+    values_[i] = value;
+    weights_[i] = (weight < max_weight) ? weight : max_weight;
+  }
+
+  // Call f(key, value) for every set in the table except the empty set,
+  // where key points to the key_words() words of the set.
+  template <class F>
+  void for_each(F f) const {
+    for (size_t i = 0; i < bucket_count(); i++)
+      if (!is_empty(&keys_[i * key_words_]))
+        f(&keys_[i * key_words_], values_[i]);
+  }
+
+  // the buckets, as stored by TspCacheFile
+  const uint64_t* key_data() const { return &keys_[0]; }
+  const double* value_data() const { return &values_[0]; }
+
+  // Limit the number of sets in the table (0 means no limit). If the table
+  // holds more sets, the excess is evicted, and if it has more buckets than
+  // the limit can fill, it is shrunk.
+  void set_max_entries(size_t n) {
+    max_entries_ = n;
+    while ((max_entries_ > 0) && (size_ > max_entries_))
+      evict();
+    size_t buckets = static_cast<size_t>(n / max_load_factor) + 1;
+    if ((n > 0) && (buckets < bucket_count()))
+      rehash(buckets);
+  }
+
+  size_t max_entries() const {
+    return max_entries_;
+  }
+
+  // number of sets evicted so far
+  size_t evictions() const {
+    return evictions_;
+  }
+
+  // Largest number of bytes the table takes per set it holds, i.e. when it
+  // has just grown to twice max_load_factor.
+  size_t bytes_per_entry() const {
+    return static_cast<size_t>((key_words_ * sizeof(uint64_t) + sizeof(double) + 1) 
+                               / max_load_factor * 2);
+  }
+
+  // Make room for n sets without growing the table.
+  void reserve(size_t n) {
+    rehash(static_cast<size_t>(n / max_load_factor) + 1);
+  }
+
+  // Resize the table to at least the given number of buckets (rounded up
+  // to a power of two, and large enough for the current contents).
+  void rehash(size_t buckets) {
+    size_t count = 16;
+    while ((count < buckets) || (size_ > max_load_factor * count))
+      count *= 2;
+    if ((count == bucket_count()) && !keys_.empty())
+      return;
+
+    std::vector<uint64_t> keys(count * key_words_, 0);
+    std::vector<double> values(count);
+    std::vector<uint8_t> weights(count, 0);
+    keys.swap(keys_);
+    values.swap(values_);
+    weights.swap(weights_);
+    mask_ = count - 1;
+    hand_ = 0;
+    for (size_t j = 0; j < values.size(); j++) {
+      const uint64_t* key = &keys[j * key_words_];
+      if (is_empty(key))
+        continue;
+      size_t i = hash(key) & mask_;
+      while (!is_empty(&keys_[i * key_words_]))
+        i = (i + 1) & mask_;
+      memcpy(&keys_[i * key_words_], key, key_words_ * sizeof(uint64_t));
+      values_[i] = values[j];
+      weights_[i] = weights[j];
+    }
+  }
+
+  // number of sets in the table
+  size_t size() const {
+    return size_ + (has_empty_ ? 1 : 0);
+  }
+
+  size_t bucket_count() const {
+    return values_.size();
+  }
+
+  double load_factor() const {
+    return size_ / static_cast<double>(bucket_count());
+  }
+
+  // memory used by the table, in bytes
+  size_t memory_usage() const {
+    return keys_.capacity() * sizeof(uint64_t) + values_.capacity() * sizeof(double)
+      + weights_.capacity() * sizeof(uint8_t);
+  }
+
+  // hash value of a set
+  static inline size_t hash(const dbitset& bs) {
+    return bs.hash();
+  }
+
+  inline bool is_empty(const uint64_t* key) const {
+    for (size_t k = 0; k < key_words_; k++)
+      if (key[k] != 0)
+        return false;
+    return true;
+  }
+
+  inline bool equal(const uint64_t* a, const uint64_t* b) const {
+    for (size_t k = 0; k < key_words_; k++)
+      if (a[k] != b[k])
+        return false;
+    return true;
+  }
+
+  // hash value of a set given by its key words; the same as dbitset::hash
+  inline size_t hash(const uint64_t* key) const {
+    return dbitset::hash(key, key_words_);
+  }
+
+private:
+  size_t key_words_;              // number of 64-bit words per key
+  std::vector<uint64_t> keys_;    // key_words_ words per bucket, 0 if unused
+  std::vector<double> values_;
+  std::vector<uint8_t> weights_;  // CLOCK counters
+  size_t mask_;                   // bucket_count() - 1
+  size_t size_;                   // number of used buckets
+  bool has_empty_;                // the empty set cannot be stored in a
+  double empty_value_;            // bucket, so it is kept separately
+  size_t max_entries_;            // largest number of sets, 0 if no limit
+  size_t hand_;                   // position of the clock hand
+  size_t evictions_;              // number of sets evicted
+
+  // Advance the clock hand until it finds a set with counter 0, lowering the
+  // counters on its way, and remove that set.
+  void evict() {
+    for (; ; hand_ = (hand_ + 1) & mask_) {
+      if (is_empty(&keys_[hand_ * key_words_]))
+        continue;
+      if (weights_[hand_] == 0)
+        break;
+      weights_[hand_]--;
+    }
+    erase(hand_);
+    evictions_++;
+  }
+
+  // Remove the set in bucket i. The sets following it in the same run of
+  // used buckets are shifted back where needed, so that every set can 
+  // still be reached from its home bucket without passing an empty one.
+  void erase(size_t i) {
+    size_t j = i;
+    for (;;) {
+      j = (j + 1) & mask_;
+      uint64_t* slot = &keys_[j * key_words_];
+      if (is_empty(slot))
+        break;
+      // the set in bucket j may move to bucket i if its home bucket does
+      // not lie cyclically in (i, j]
+      size_t home = hash(slot) & mask_;
+      if (((j - home) & mask_) >= ((j - i) & mask_)) {
+        memcpy(&keys_[i * key_words_], slot, key_words_ * sizeof(uint64_t));
+        values_[i] = values_[j];
+        weights_[i] = weights_[j];
+        i = j;
+      }
+    }
+    memset(&keys_[i * key_words_], 0, key_words_ * sizeof(uint64_t));
+    size_--;
+  }
+};
+
+/* A TspCache that is split into shards, each with its own lock. A set is
+   stored in the shard given by the high bits of its hash value, while the
+   low bits select its bucket within the shard. Threads only contend when
+   they access the same shard at the same time. */
+template <unsigned int SHARDS = 64>
+class ShardedTspCache {
+public:
+  // Empty the cache and prepare it for keys of the given number of 64-bit
+  // words. The limit on the number of sets is kept.
+  void set_key_words(size_t key_words) {
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      size_t max_entries = shards_[k].table.max_entries();
+      shards_[k].table = TspCache(key_words);
+      shards_[k].table.set_max_entries(max_entries);
+    }
+  }
+
+  size_t key_words() const {
+    return shards_[0].table.key_words();
+  }
+
+  bool find(const dbitset& bs, double* value) {
+    size_t h = TspCache::hash(bs);
+    Shard& shard = shards_[shard_index(h)];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.table.find(bs, h, value);
+  }
+
+  void insert(const dbitset& bs, double value, int weight = 1) {
+    size_t h = TspCache::hash(bs);
+    Shard& shard = shards_[shard_index(h)];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.table.insert(bs, h, value, weight);
+  }
+
+  // Limit the total number of sets (0 means no limit); every shard gets an
+  // equal part of the limit.
+  void set_max_entries(size_t n) {
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      shards_[k].table.set_max_entries((n == 0) ? 0 : (n + SHARDS - 1) / SHARDS);
+    }
+  }
+
+  // Limit the memory used by the cache to about the given number of bytes
+  // (0 means no limit). The limit depends on the number of words per key,
+  // so it must be set after set_key_words().
+  void set_max_bytes(size_t bytes) {
+    size_t n = bytes / shards_[0].table.bytes_per_entry();
+    set_max_entries((bytes == 0) ? 0 : ((n > 0) ? n : 1));
+  }
+
+  size_t evictions() {
+    size_t count = 0;
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      count += shards_[k].table.evictions();
+    }
+    return count;
+  }
+
+  size_t memory_usage() {
+    size_t bytes = 0;
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      bytes += shards_[k].table.memory_usage();
+    }
+    return bytes;
+  }
+
+  // Make room for n sets in total without growing the shards.
+  void reserve(size_t n) {
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      shards_[k].table.reserve(n / SHARDS + 1);
+    }
+  }
+
+  size_t size() {
+    size_t count = 0;
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      count += shards_[k].table.size();
+    }
+    return count;
+  }
+
+  size_t bucket_count() {
+    size_t count = 0;
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      count += shards_[k].table.bucket_count();
+    }
+    return count;
+  }
+
+  double load_factor() {
+    return size() / static_cast<double>(bucket_count());
+  }
+
+  // Call f(key, value) for every set, see TspCache::for_each.
+  template <class F>
+  void for_each(F f) {
+    for (unsigned int k = 0; k < SHARDS; k++) {
+      std::lock_guard<std::mutex> guard(shards_[k].lock);
+      shards_[k].table.for_each(f);
+    }
+  }
+
+private:
+  // shards are aligned to cache lines, so that their locks do not share one
+  struct alignas(64) Shard {
+    std::mutex lock;
+    TspCache table;
+  };
+  Shard shards_[SHARDS];
+
+  static inline unsigned int shard_index(size_t h) {
+    return (h >> 40) % SHARDS;
+  }
+};
+
+#endif
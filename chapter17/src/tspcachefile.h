@@ -0,0 +1,231 @@
+/*
+ * Persistent TSP cache
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a file format for storing TSP tour lengths
+   between runs. The file holds a header followed by the key and value
+   arrays of a TspCache, so it is mapped into memory and searched in place,
+   without reading or copying it. The header carries a fingerprint of the
+   data the tour lengths were calculated from (platform coordinates and
+   range); a file with a different fingerprint is ignored, and replaced when
+   the cache is saved. */
+
+#ifndef TSPCACHEFILE__
+#define TSPCACHEFILE__
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "dbitset.h"
+#include "tspcache.h"
+
+/* Header of a TSP cache file. The key array starts right after it, and
+   the value array right after the key array. */
+struct TspCacheFileHeader {
+  char     magic[8];          // "TSPCACHE"
+  uint32_t version;           // _TSPCACHEFILE_VERSION
+  uint32_t key_words;         // number of 64-bit words per key
+  uint64_t fingerprint;       // fingerprint of the platform data and range
+  uint64_t buckets;           // number of buckets, a power of two
+  uint64_t size;              // number of used buckets
+  uint64_t reserved[3];
+};
+
+/* Version of the file format; it must be raised whenever the layout or
+   TspCache::hash changes. */
+#define _TSPCACHEFILE_VERSION 1
+
+/* This function calculates the 64-bit FNV-1a hash of a block of bytes,
+   continuing from a previous hash value h. */
+inline uint64_t fnv1a_hash(const void* data, size_t length,
+                           uint64_t h = 0xcbf29ce484222325ULL) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < length; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+class TspCacheFile {
+public:
+  TspCacheFile() : map_(NULL), map_size_(0), keys_(NULL), values_(NULL),
+                   key_words_(1), mask_(0), size_(0) { }
+
+  ~TspCacheFile() {
+    close();
+  }
+
+  // Map a cache file with keys of key_words 64-bit words into memory.
+  // Returns false if the file does not exist, does not belong to the
+  // given fingerprint, or is damaged; the object is then empty.
+  bool open(const std::string& path, size_t key_words, uint64_t fingerprint) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if ((fstat(fd, &st) == 0) && (st.st_size >= sizeof(TspCacheFileHeader)))
+      map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+      return false;
+    map_ = map;
+    map_size_ = st.st_size;
+
+    const TspCacheFileHeader* header = static_cast<const TspCacheFileHeader*>(map_);
+    size_t buckets = header->buckets;
+    if ((memcmp(header->magic, "TSPCACHE", 8) != 0)
+        || (header->version != _TSPCACHEFILE_VERSION)
+        || (header->key_words != key_words)
+        || (header->fingerprint != fingerprint)
+        || (buckets == 0) || ((buckets & (buckets - 1)) != 0)
+        || (header->size >= buckets)
+        || (map_size_ != file_size(buckets, key_words))) {
+      close();
+      return false;
+    }
+    keys_ = reinterpret_cast<const uint64_t*>(header + 1);
+    values_ = reinterpret_cast<const double*>(keys_ + buckets * key_words);
+    key_words_ = key_words;
+    mask_ = buckets - 1;
+    size_ = header->size;
+    return true;
+  }
+
+  void close() {
+    if (map_ != NULL)
+      munmap(map_, map_size_);
+    map_ = NULL;
+    map_size_ = 0;
+    keys_ = NULL;
+    values_ = NULL;
+    mask_ = 0;
+    size_ = 0;
+  }
+
+  // Look up a set with hash value h (see TspCache::hash). At most all 
+  // buckets are probed, so that a damaged file without empty buckets 
+  // cannot make a lookup loop forever.
+  bool find(const dbitset& bs, size_t h, double* value) const {
+    if (size_ == 0)
+      return false;
+    assert(bs.num_words() == key_words_);
+    const uint64_t* key = bs.words();
+    size_t i = h & mask_;
+    for (size_t probe = 0; probe <= mask_; probe++, i = (i + 1) & mask_) {
+      const uint64_t* slot = &keys_[i * key_words_];
+      bool equal = true, empty = true;
+      for (size_t k = 0; k < key_words_; k++) {
+        equal = equal && (slot[k] == key[k]);
+        empty = empty && (slot[k] == 0);
+      }
+      if (equal) {
+        *value = values_[i];
+        return true;
+      }
+      if (empty)
+        return false;
+    }
+    return false;
+  }
+
+  // number of sets in the file
+  size_t size() const {
+    return size_;
+  }
+
+  // Write the sets in this file together with those in cache to a new
+  // file, which replaces the file at path once it is complete. The file
+  // is left alone if cache holds no new sets. Returns
+  // the number of sets written, or -1 on failure.
+  long save(const std::string& path, uint64_t fingerprint,
+            ShardedTspCache<>& cache) const {
+    size_t key_words = cache.key_words();
+    TspCache table(key_words);
+    table.reserve(std::max(size_, cache.size()));
+    if (key_words == key_words_)
+      for (size_t i = 0; i <= mask_ && size_ > 0; i++) {
+        const uint64_t* key = &keys_[i * key_words];
+        if (!table.is_empty(key))
+          table.insert_key(key, table.hash(key), values_[i]);
+      }
+    cache.for_each([&table](const uint64_t* key, double value) {
+      table.insert_key(key, table.hash(key), value);
+    });
+    if ((size_ > 0) && (table.size() == size_))
+      return size_;              // nothing new, keep the file as it is
+
+    TspCacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "TSPCACHE", 8);
+    header.version = _TSPCACHEFILE_VERSION;
+    header.key_words = key_words;
+    header.fingerprint = fingerprint;
+    header.buckets = table.bucket_count();
+    header.size = table.size();
+
+    // Write to a temporary file first, so that other runs never see a
+    // partially written file
+    char pid[32];
+    snprintf(pid, sizeof(pid), ".%ld.tmp", static_cast<long>(getpid()));
+    std::string tmp_path = path + pid;
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == NULL)
+      return -1;
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1)
+      && (fwrite(table.key_data(), sizeof(uint64_t) * key_words, header.buckets, f) == header.buckets)
+      && (fwrite(table.value_data(), sizeof(double), header.buckets, f) == header.buckets);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || (rename(tmp_path.c_str(), path.c_str()) != 0)) {
+      unlink(tmp_path.c_str());
+      return -1;
+    }
+    return header.size;
+  }
+
+private:
+  void* map_;
+  size_t map_size_;
+  const uint64_t* keys_;         // the arrays in the mapped file
+  const double* values_;
+  size_t key_words_;             // number of 64-bit words per key
+  size_t mask_;                  // number of buckets - 1
+  size_t size_;                  // number of used buckets
+
+  static size_t file_size(size_t buckets, size_t key_words) {
+    return sizeof(TspCacheFileHeader) + buckets * (key_words * sizeof(uint64_t) + sizeof(double));
+  }
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Work-stealing thread pool
+ * Copyright (C) 2013 Y. Zwols
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* This header file provides a pool of threads that run tasks with work
+   stealing. Every worker has a deque of tasks. A worker takes its next task
+   from the back of its own deque, and the tasks that a task creates are
+   added to the back as well, so that every worker goes through its part of
+   the work depth first. A worker whose deque is empty steals the task at
+   the front of the deque of another worker, which is the oldest and
+   usually the largest task there. The deques only hold a few tasks at a
+   time, so each is simply protected by a mutex.
+   The thread that calls run() takes part as worker 0; the other workers
+   are threads that sleep until the next call of run(). A worker that finds
+   no task to take sleeps as well, until a task is added or the job ends.
+   A pool is meant to be created once and used for many calls of run(). */
+
+#ifndef WORKSTEALING__
+#define WORKSTEALING__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+template <class Task>
+class WorkStealingPool {
+public:
+  // the function that runs a task, given the number of the worker
+  typedef std::function<void(int, const Task&)> Function;
+
+  // constructor starts the given number of workers, including the caller
+  explicit WorkStealingPool(int workers)
+    : queues_((workers > 1) ? workers : 1), job_(0), busy_(0),
+      quit_(false), stop_(false), pending_(0), queued_(0) {
+    for (int k = 1; k < size(); k++)
+      threads_.push_back(std::thread(&WorkStealingPool::thread_main, this, k));
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      quit_ = true;
+    }
+    wake_.notify_all();
+    for (size_t k = 0; k < threads_.size(); k++)
+      threads_[k].join();
+  }
+
+  // number of workers
+  int size() const {
+    return queues_.size();
+  }
+
+  // Add a task to the deque of the given worker. Tasks are added before
+  // run() is called, or by the running tasks themselves.
+  void push(int worker, const Task& task) {
+    pending_++;
+    {
+      Queue& queue = queues_[worker];
+      std::lock_guard<std::mutex> guard(queue.lock);
+      queue.tasks.push_back(task);
+    }
+    queued_++;
+    if (size() > 1) {
+      std::lock_guard<std::mutex> guard(idle_lock_);
+      idle_.notify_one();
+    }
+  }
+
+  // Let the workers finish their current tasks and drop all other tasks.
+  void stop() {
+    stop_ = true;
+    std::lock_guard<std::mutex> guard(idle_lock_);
+    idle_.notify_all();
+  }
+
+  bool stopped() const {
+    return stop_;
+  }
+
+  // Run f(worker, task) for all tasks until there are none left, or until
+  // stop() is called.
+  void run(Function f) {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      function_ = f;
+      busy_ = size() - 1;
+      job_++;
+    }
+    wake_.notify_all();
+    work(0);
+    {
+      std::unique_lock<std::mutex> guard(lock_);
+      done_.wait(guard, [this] { return busy_ == 0; });
+    }
+
+    // only tasks that were dropped by stop() are left
+    for (int k = 0; k < size(); k++)
+      queues_[k].tasks.clear();
+    pending_ = 0;
+    queued_ = 0;
+    stop_ = false;
+  }
+
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<Queue> queues_;         // the deque of each worker
+  std::vector<std::thread> threads_;  // workers 1, 2, ...
+  std::mutex lock_;                   // protects the four variables below
+  std::condition_variable wake_;      // signals a new job to the workers
+  std::condition_variable done_;      // signals the end of a job to run()
+  Function function_;
+  unsigned long job_;                 // number of calls of run()
+  int busy_;                          // threads still working on the job
+  bool quit_;
+  std::atomic<bool> stop_;
+  std::atomic<long> pending_;         // tasks that have not finished yet
+  std::atomic<long> queued_;          // tasks in the deques
+  std::mutex idle_lock_;              // lock of idle_
+  std::condition_variable idle_;      // signals a new task or the end of a job
+
+  // take the task at the back of the worker's own deque
+  bool pop(int worker, Task& task) {
+    Queue& queue = queues_[worker];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.empty())
+      return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    queued_--;
+    return true;
+  }
+
+  // take the task at the front of the deque of another worker
+  bool steal(int worker, Task& task) {
+    for (int k = 1; k < size(); k++) {
+      Queue& queue = queues_[(worker + k) % size()];
+      std::lock_guard<std::mutex> guard(queue.lock);
+      if (!queue.tasks.empty()) {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        queued_--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Run tasks until there are none left. A task only finishes after the
+  // tasks it creates have been added, so none can appear once pending_
+  // is 0. Without a task to take, the worker waits until one is added, 
+  // the last task finishes, or the job is stopped.
+  void work(int worker) {
+    Task task;
+    while (!stop_ && (pending_ > 0)) {
+      if (pop(worker, task) || steal(worker, task)) {
+        if (!stop_)
+          function_(worker, task);
+        if (--pending_ == 0) {
+          std::lock_guard<std::mutex> guard(idle_lock_);
+          idle_.notify_all();
+        }
+      } else {
+        std::unique_lock<std::mutex> guard(idle_lock_);
+        idle_.wait(guard, [this] { return stop_ || (pending_ == 0) || (queued_ > 0); });
+      }
+    }
+  }
+
+  void thread_main(int worker) {
+    unsigned long job = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> guard(lock_);
+        wake_.wait(guard, [this, job] { return quit_ || (job_ != job); });
+        if (quit_)
+          return;
+        job = job_;
+      }
+      work(worker);
+      {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (--busy_ == 0)
+          done_.notify_all();
+      }
+    }
+  }
+};
+
+#endif